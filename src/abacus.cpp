@@ -0,0 +1,329 @@
+/////////////////////////////////////////////////////////////////////////////
+// Authors: SangGi Do(sanggido@unist.ac.kr), Mingyu Woo(mwoo@eng.ucsd.edu)
+//          (respective Ph.D. advisors: Seokhyeong Kang, Andrew B. Kahng)
+//
+//          Original parsing structure was made by Myung-Chul Kim (IBM).
+//
+// BSD 3-Clause License
+//
+// Copyright (c) 2018, SangGi Do and Mingyu Woo
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "circuit.h"
+
+using opendp::circuit;
+using opendp::cell;
+using opendp::macro;
+using opendp::group;
+using opendp::free_site_map;
+
+using std::max;
+using std::min;
+using std::abs;
+using std::cout;
+using std::endl;
+using std::vector;
+using std::pair;
+using std::make_pair;
+
+// Abacus ( Spindler et al., ISPD 2008 ) on the free runs of a placement
+// class. Single row cells are taken in x order; each one is tried in the
+// rows around its global placement position, collapsed into the clusters of
+// the row segments near it, and kept where its own displacement is the
+// smallest. A cluster sits at the closed form optimum of the quadratic x
+// displacement of its cells, rounded to a site. Multi-row cells are placed
+// first with the pixel search, so the rows they span see them as blockages.
+
+namespace {
+
+struct abacus_cluster {
+  double e;  /* total weight */
+  double q;  /* sum of e_i * ( x_i - offset of cell i ) */
+  int w;     /* width in sites */
+  int x;     /* position in sites */
+  int first; /* index of the first cell in the segment */
+};
+
+struct abacus_segment {
+  int y;
+  int x_begin; /* sites [x_begin, x_end) */
+  int x_end;
+  int used; /* width of the cells in the segment */
+  vector< cell* > cells;
+  vector< abacus_cluster > clusters;
+};
+
+int cluster_x(const abacus_cluster& theCluster,
+              const abacus_segment& theSegment) {
+  int x = (int)floor(theCluster.q / theCluster.e + 0.5);
+  x = min(x, theSegment.x_end - theCluster.w);
+  return max(x, theSegment.x_begin);
+}
+
+// appends theCluster to theSegment's clusters and merges it with the ones it
+// overlaps. commit == false only returns the position the last cell would
+// get, leaving the segment as it is
+int collapse(abacus_segment& theSegment, abacus_cluster theCluster,
+             bool commit) {
+  int width = theCluster.w;
+  int i = theSegment.clusters.size();
+  while(true) {
+    theCluster.x = cluster_x(theCluster, theSegment);
+    if(i == 0) break;
+    const abacus_cluster& prev = theSegment.clusters[i - 1];
+    if(prev.x + prev.w <= theCluster.x) break;
+    theCluster.q = prev.q + theCluster.q - theCluster.e * prev.w;
+    theCluster.e += prev.e;
+    theCluster.w += prev.w;
+    theCluster.first = prev.first;
+    i--;
+  }
+  if(commit) {
+    theSegment.clusters.resize(i);
+    theSegment.clusters.push_back(theCluster);
+  }
+  return theCluster.x + theCluster.w - width;
+}
+
+}  // namespace
+
+// returns false if a cell could not be placed and shift is not allowed
+bool circuit::abacus_placement(free_site_map* theMap, vector< cell* >& cell_list,
+                               bool shift) {
+  // footprint width ( cell + edge spacing ) and left spacing, in sites
+  auto footprint = [&](cell* theCell, int& edge_left) {
+    macro* theMacro = &macros[theCell->type];
+    edge_left = (theMacro->edgetypeLeft == 1) ? 2 : 0;
+    int edge_right = (theMacro->edgetypeRight == 1) ? 2 : 0;
+    return (int)ceil(theCell->width / wsite) + edge_left + edge_right;
+  };
+
+  vector< cell* > single_list;
+  vector< cell* > multi_list;
+  for(int i = 0; i < cell_list.size(); i++) {
+    cell* theCell = cell_list[i];
+    if((int)ceil(theCell->height / rowHeight) > 1)
+      multi_list.push_back(theCell);
+    else
+      single_list.push_back(theCell);
+  }
+  sort(multi_list.begin(), multi_list.end(), [](cell* a, cell* b) {
+    if(a->width * a->height != b->width * b->height)
+      return a->width * a->height > b->width * b->height;
+    return a->id < b->id;
+  });
+  for(int i = 0; i < multi_list.size(); i++) {
+    cell* theCell = multi_list[i];
+    if(map_move(theCell, MODE_INIT_COORD) == true) continue;
+    if(shift == false) return false;
+    shift_move(theCell, MODE_INIT_COORD);
+  }
+
+  // row segments of the class, in increasing x per row
+  int y_begin = theMap->y_begin();
+  int y_end = theMap->y_end();
+  vector< abacus_segment > segments;
+  vector< vector< int > > row_segments(y_end - y_begin);
+  // widest room left in any segment of the row
+  vector< int > row_room(y_end - y_begin, 0);
+  vector< pair< int, int > > runs;
+  for(int y = y_begin; y < y_end; y++) {
+    theMap->free_runs(y, runs);
+    for(int i = 0; i < runs.size(); i++) {
+      row_room[y - y_begin] =
+          max(row_room[y - y_begin], runs[i].second - runs[i].first);
+      abacus_segment theSegment;
+      theSegment.y = y;
+      theSegment.x_begin = runs[i].first;
+      theSegment.x_end = runs[i].second;
+      theSegment.used = 0;
+      row_segments[y - y_begin].push_back(segments.size());
+      segments.push_back(theSegment);
+    }
+  }
+
+  sort(single_list.begin(), single_list.end(), [](cell* a, cell* b) {
+    if(a->init_x_coord != b->init_x_coord)
+      return a->init_x_coord < b->init_x_coord;
+    return a->id < b->id;
+  });
+
+  vector< cell* > fail_list;
+  for(int i = 0; i < single_list.size(); i++) {
+    cell* theCell = single_list[i];
+    int edge_left = 0;
+    int width = footprint(theCell, edge_left);
+    double x_target = theCell->init_x_coord / (double)wsite - edge_left;
+    int y_mid = (int)floor(theCell->init_y_coord / rowHeight + 0.5);
+    y_mid = max(y_begin, min(y_end - 1, y_mid));
+
+    // rows in increasing distance, segments in increasing distance from
+    // x_target on both sides, while they can still beat the best
+    double best_cost = std::numeric_limits< double >::max();
+    int best_segment = -1;
+    for(int d = 0;; d++) {
+      bool closer = false;
+      for(int k = 0; k < 2; k++) {
+        int y = (k == 0) ? y_mid - d : y_mid + d;
+        if(k == 1 && d == 0) break;
+        if(y < y_begin || y >= y_end) continue;
+        double y_cost = abs(theCell->init_y_coord - y * rowHeight);
+        if(y_cost >= best_cost) continue;
+        closer = true;
+        if(row_room[y - y_begin] < width) continue;
+
+        vector< int >& theRow = row_segments[y - y_begin];
+        int right = std::upper_bound(theRow.begin(), theRow.end(), x_target,
+                                     [&](double x, int s) {
+                                       return x < segments[s].x_end - width;
+                                     }) -
+                    theRow.begin();
+        for(int j = right - 1; j >= 0; j--) {
+          abacus_segment& theSegment = segments[theRow[j]];
+          double bound =
+              max(0.0, x_target - (theSegment.x_end - width)) * wsite + y_cost;
+          if(bound >= best_cost) break;
+          if(theSegment.x_end - theSegment.x_begin - theSegment.used < width)
+            continue;
+          abacus_cluster theCluster = {1.0, x_target, width, 0,
+                                       (int)theSegment.cells.size()};
+          int x = collapse(theSegment, theCluster, false);
+          double cost = abs(x - x_target) * wsite + y_cost;
+          if(cost < best_cost) {
+            best_cost = cost;
+            best_segment = theRow[j];
+          }
+        }
+        for(int j = right; j < theRow.size(); j++) {
+          abacus_segment& theSegment = segments[theRow[j]];
+          double bound =
+              max(0.0, theSegment.x_begin - x_target) * wsite + y_cost;
+          if(bound >= best_cost) break;
+          if(theSegment.x_end - theSegment.x_begin - theSegment.used < width)
+            continue;
+          abacus_cluster theCluster = {1.0, x_target, width, 0,
+                                       (int)theSegment.cells.size()};
+          int x = collapse(theSegment, theCluster, false);
+          double cost = abs(x - x_target) * wsite + y_cost;
+          if(cost < best_cost) {
+            best_cost = cost;
+            best_segment = theRow[j];
+          }
+        }
+      }
+      if(closer == false) break;
+    }
+
+    if(best_segment == -1) {
+      fail_list.push_back(theCell);
+      continue;
+    }
+    abacus_segment& theSegment = segments[best_segment];
+    abacus_cluster theCluster = {1.0, x_target, width, 0,
+                                 (int)theSegment.cells.size()};
+    collapse(theSegment, theCluster, true);
+    theSegment.cells.push_back(theCell);
+    theSegment.used += width;
+
+    vector< int >& theRow = row_segments[theSegment.y - y_begin];
+    int room = 0;
+    for(int j = 0; j < theRow.size(); j++) {
+      abacus_segment& other = segments[theRow[j]];
+      room = max(room, other.x_end - other.x_begin - other.used);
+    }
+    row_room[theSegment.y - y_begin] = room;
+  }
+
+  // cells of a cluster abut from the cluster position
+  for(int i = 0; i < segments.size(); i++) {
+    abacus_segment& theSegment = segments[i];
+    for(int j = 0; j < theSegment.clusters.size(); j++) {
+      abacus_cluster& theCluster = theSegment.clusters[j];
+      int last = (j + 1 < theSegment.clusters.size())
+                     ? theSegment.clusters[j + 1].first
+                     : theSegment.cells.size();
+      int x = theCluster.x;
+      for(int k = theCluster.first; k < last; k++) {
+        cell* theCell = theSegment.cells[k];
+        int edge_left = 0;
+        int width = footprint(theCell, edge_left);
+        paint_pixel(theCell, x + edge_left, theSegment.y);
+        x += width;
+      }
+    }
+  }
+
+  for(int i = 0; i < fail_list.size(); i++) {
+    cell* theCell = fail_list[i];
+    if(map_move(theCell, MODE_INIT_COORD) == true) continue;
+    if(shift == false) return false;
+    shift_move(theCell, MODE_INIT_COORD);
+  }
+  return true;
+}
+
+void circuit::abacus_group_cell_placement() {
+  vector< group* > group_list = groups_by_size();
+#pragma omp parallel for num_threads(num_cpu) schedule(dynamic, 1)
+  for(int i = 0; i < group_list.size(); i++) {
+    group* theGroup = group_list[i];
+    int theClass = theGroup - &groups[0];
+    vector< cell* > cell_list;
+    for(int j = 0; j < theGroup->siblings.size(); j++) {
+      cell* theCell = theGroup->siblings[j];
+      if(theCell->isFixed || theCell->isPlaced) continue;
+      cell_list.push_back(theCell);
+    }
+    if(abacus_placement(&free_sites[theClass], cell_list, false) == true)
+      continue;
+
+    // same fallback as group_cell_placement
+    for(int j = 0; j < theGroup->siblings.size(); j++) {
+      erase_pixel(theGroup->siblings[j]);
+    }
+    if(theGroup->util > 0.95)
+      brick_placement_1(theGroup);
+    else
+      brick_placement_2(theGroup);
+  }
+  return;
+}
+
+void circuit::abacus_non_group_cell_placement() {
+  vector< cell* > cell_list;
+  cell_list.reserve(cells.size());
+  for(int i = 0; i < cells.size(); i++) {
+    cell* theCell = &cells[i];
+    if(theCell->isFixed || theCell->inGroup || theCell->isPlaced) continue;
+    cell_list.push_back(theCell);
+  }
+  abacus_placement(&free_sites[groups.size()], cell_list, true);
+  return;
+}
@@ -43,6 +43,7 @@ using opendp::circuit;
 using opendp::cell;
 using opendp::row;
 using opendp::pixel;
+using opendp::pixel_grid;
 using opendp::rect;
 
 using std::max;
@@ -51,6 +52,95 @@ using std::pair;
 using std::cout;
 using std::endl;
 using std::cerr;
+using std::vector;
+using std::fill;
+
+void pixel_grid::init(int num_rows, int num_cols, const pixel& fill) {
+  num_rows_ = num_rows;
+  num_cols_ = num_cols;
+  tiles_x_ = (num_cols + TILE_COLS - 1) / TILE_COLS;
+  tiles_y_ = (num_rows + TILE_ROWS - 1) / TILE_ROWS;
+
+  pixel blocked;
+  blocked.cell_id = PIXEL_DUMMY;
+  blocked.setValid(false);
+  invalid_tile_.assign(TILE_ROWS * TILE_COLS, fill);
+  blocked_tile_.assign(TILE_ROWS * TILE_COLS, blocked);
+
+  size_t num_tiles = static_cast< size_t >(tiles_x_) * tiles_y_;
+  tiles_.assign(num_tiles, &invalid_tile_[0]);
+  owned_.clear();
+  owned_.resize(num_tiles);
+  return;
+}
+
+void pixel_grid::allocate_tile(int tile) {
+  owned_[tile].reset(new pixel[TILE_ROWS * TILE_COLS]);
+  std::copy(tiles_[tile], tiles_[tile] + TILE_ROWS * TILE_COLS,
+            owned_[tile].get());
+  tiles_[tile] = owned_[tile].get();
+  return;
+}
+
+void pixel_grid::share_tile(int tile_x, int tile_y, shared_tile type) {
+  int tile = tile_y * tiles_x_ + tile_x;
+  owned_[tile].reset();
+  tiles_[tile] = (type == BLOCKED_TILE) ? &blocked_tile_[0] : &invalid_tile_[0];
+  return;
+}
+
+int pixel_grid::num_allocated_tiles() const {
+  int count = 0;
+  for(int i = 0; i < owned_.size(); i++) {
+    if(owned_[i]) count++;
+  }
+  return count;
+}
+
+size_t pixel_grid::memory_usage() const {
+  return static_cast< size_t >(num_allocated_tiles()) * TILE_ROWS *
+             TILE_COLS * sizeof(pixel) +
+         tiles_.capacity() * sizeof(const pixel*) +
+         owned_.capacity() * sizeof(std::unique_ptr< pixel[] >);
+}
+
+cell* circuit::pixel_cell(const pixel* thePixel) {
+  if(thePixel->cell_id == PIXEL_EMPTY) return NULL;
+  if(thePixel->cell_id == PIXEL_DUMMY) return &dummy_cell;
+  return &cells[thePixel->cell_id];
+}
+
+// Tiles lying inside a fixed cell, away from its left / right edges ( the
+// edge_check needs those ), are never placed on. They share the blocked
+// tile before the rows are marked valid, so they are never allocated.
+void circuit::share_blocked_tiles() {
+  for(int i = 0; i < cells.size(); i++) {
+    cell* theCell = &cells[i];
+    if(theCell->isFixed == false) continue;
+
+    int y_start = max(0, (int)floor(theCell->y_coord / rowHeight));
+    int y_end = min(grid.num_rows(),
+                    (int)ceil((theCell->y_coord + theCell->height) / rowHeight));
+    int x_start = (int)floor(theCell->x_coord / wsite);
+    int x_end = (int)ceil((theCell->x_coord + theCell->width) / wsite);
+
+    int tile_y_start = (y_start + pixel_grid::TILE_ROWS - 1) /
+                       pixel_grid::TILE_ROWS;
+    int tile_y_end = y_end / pixel_grid::TILE_ROWS;
+    // one site of the cell is left on both sides of the shared tiles
+    int tile_x_start = (max(0, x_start + 1) + pixel_grid::TILE_COLS - 1) /
+                       pixel_grid::TILE_COLS;
+    int tile_x_end =
+        min(grid.num_cols(), x_end - 1) / pixel_grid::TILE_COLS;
+
+    for(int j = tile_y_start; j < tile_y_end; j++) {
+      for(int k = tile_x_start; k < tile_x_end; k++) {
+        grid.share_tile(k, j, pixel_grid::BLOCKED_TILE);
+      }
+    }
+  }
+  return;
+}
 
 // Fixed cell handle on parser ( no need to use this function during placement)
 // //
@@ -76,7 +166,7 @@ void circuit::fixed_cell_assign() {
       x_end = min(x_end, x_end_rf);
 
 #ifdef DEBUG
-      cout << " cell_name : " << theCell->name << endl;
+      cout << " cell_name : " << cell_name(theCell) << endl;
       cout << " y_start : " << y_start << endl;
       cout << " y_end   : " << y_end << endl;
       cout << " x_start : " << x_start << endl;
@@ -84,8 +174,9 @@ void circuit::fixed_cell_assign() {
 #endif
       for(int j = y_start; j < y_end; j++) {
         for(int k = x_start; k < x_end; k++) {
-          grid[j][k].linked_cell = theCell;
-          grid[j][k].util = 1.0;
+          // no row ( invalid ) or blocked : nothing to record
+          if(get_pixel(k, j)->isValid() == false) continue;
+          edit_pixel(k, j)->cell_id = theCell->id;
         }
       }
     }
@@ -98,14 +189,14 @@ void circuit::print_pixels() {
 
   for(int i = 0; i < rows.size(); i++) {
     for(int j = 0; j < rows[i].numSites; j++) {
-      // cout << grid[i][j].util << " ";
-      if(grid[i][j].util > 0.00001) {
-        cout << grid[i][j].util << " ";
-        if(grid[i][j].group == UINT_MAX) {
+      const pixel* thePixel = get_pixel(j, i);
+      if(thePixel->isEmpty() == false) {
+        cout << thePixel->cell_id << " ";
+        if(thePixel->group == PIXEL_NO_GROUP) {
           cout << " no_group ";
         }
         else {
-          cout << groups[grid[i][j].group].name << " ";
+          cout << groups[thePixel->group].name << " ";
         }
       }
     }
@@ -123,9 +214,10 @@ void circuit::group_cell_region_assign() {
     double area = 0;
     for(int j = 0; j < rows.size(); j++) {
       for(int k = 0; k < rows[j].numSites; k++) {
-        if(grid[j][k].group != UINT_MAX) {
-          if(grid[j][k].isValid == true) {
-            if(groups[grid[j][k].group].name == theGroup->name)
+        const pixel* thePixel = get_pixel(k, j);
+        if(thePixel->group != PIXEL_NO_GROUP) {
+          if(thePixel->isValid() == true) {
+            if(groups[thePixel->group].name == theGroup->name)
               area += wsite * rowHeight;
           }
         }
@@ -140,9 +232,9 @@ void circuit::group_cell_region_assign() {
       unsigned region_backup = UINT_MAX;
       for(int k = 0; k < theGroup->regions.size(); k++) {
         rect* theRect = &theGroup->regions[k];
-        if(check_inside(theCell, theRect, "init_coord") == true)
+        if(check_inside(theCell, theRect, MODE_INIT_COORD) == true)
           theCell->region = k;
-        int temp_dist = dist_for_rect(theCell, theRect, "init_coord");
+        int temp_dist = dist_for_rect(theCell, theRect, MODE_INIT_COORD);
         if(temp_dist < dist) {
           dist = temp_dist;
           region_backup = k;
@@ -258,17 +350,17 @@ void circuit::y_align() {
 void circuit::cell_y_align(cell* theCell) {
   int cell_y_size = (int)ceil(theCell->height / rowHeight);
   macro* theMacro = &macros[theCell->type];
-  pair< bool, pixel* > myPixel =
+  pair< bool, pair< int, int > > myPixel =
       diamond_search(theCell, theCell->init_x_coord, theCell->init_y_coord);
-  theCell->y_pos = myPixel.second->y_pos;
+  theCell->y_pos = myPixel.second.first;
   // top power align --> cell orient ( flip )
   if( max_cell_height > 1 ) {
     if(cell_y_size % 2 == 1 &&
-        rows[myPixel.second->y_pos].top_power != theMacro->top_power)
-      theCell->cellorient = "FS";
+        rows[myPixel.second.first].top_power != theMacro->top_power)
+      theCell->cellorient = ORIENT_FS;
   }
   else {
-    theCell->cellorient = rows[myPixel.second->y_pos].siteorient;
+    theCell->cellorient = rows[myPixel.second.first].siteorient;
   }
 
   return;
@@ -292,9 +384,8 @@ void circuit::group_pixel_assign_2() {
           // cout << "grid[" << i << "][" << j << "]";
           if(check_inside(theGrid, theGroup->regions[l]) == false &&
              check_overlap(theGrid, theGroup->regions[l]) == true) {
-            grid[i][j].util = 0.0;
-            grid[i][j].linked_cell = &dummy_cell;
-            grid[i][j].isValid = false;
+            edit_pixel(j, i)->cell_id = PIXEL_DUMMY;
+            edit_pixel(j, i)->setValid(false);
             // cout << "invalid grid[" << i << "][" << j << "] marked" << endl;
           }
         }
@@ -304,67 +395,68 @@ void circuit::group_pixel_assign_2() {
   return;
 }
 
+// the fractional region coverage ( util ) is accumulated one row at a time,
+// so no per-pixel double has to be kept on the grid.
 void circuit::group_pixel_assign() {
-  for(int i = 0; i < rows.size(); i++) {
-    row* theRow = &rows[i];
-    for(int j = 0; j < theRow->numSites; j++) {
-      grid[i][j].util = 0.0;
-    }
-  }
+  vector< double > util(grid.num_cols(), 0.0);
 
-  for(int i = 0; i < groups.size(); i++) {
-    group* theGroup = &groups[i];
-    for(int j = 0; j < theGroup->regions.size(); j++) {
-      rect* theRect = &theGroup->regions[j];
-      int row_start = (int)ceil(theRect->yLL / rowHeight);
-      int row_end = (int)floor(theRect->yUR / rowHeight);
+  for(int k = 0; k < rows.size(); k++) {
+    row* theRow = &rows[k];
+    fill(util.begin(), util.end(), 0.0);
+
+    for(int i = 0; i < groups.size(); i++) {
+      group* theGroup = &groups[i];
+      for(int j = 0; j < theGroup->regions.size(); j++) {
+        rect* theRect = &theGroup->regions[j];
+        int row_start = (int)ceil(theRect->yLL / rowHeight);
+        int row_end = (int)floor(theRect->yUR / rowHeight);
 
-      // assert((int)floor(theRect->yUR) % (int)rowHeight == 0 );
+        // assert((int)floor(theRect->yUR) % (int)rowHeight == 0 );
+        if(k < row_start || k >= row_end) continue;
 
-      for(int k = row_start; k < row_end; k++) {
-        row* theRow = &rows[k];
         int col_start = (int)floor(theRect->xLL / (double)theRow->stepX);
         int col_end = (int)ceil(theRect->xUR / (double)theRow->stepX);
 
         for(int l = col_start; l < col_end; l++) {
-          grid[k][l].util += 1.0;
+          util[l] += 1.0;
         }
         if((int)(theRect->xLL + 0.5) % theRow->stepX != 0) {
-          grid[k][col_start].util -=
-              ((int)(theRect->xLL + 0.5) % theRow->stepX) /
-              (double)theRow->stepX;
+          util[col_start] -= ((int)(theRect->xLL + 0.5) % theRow->stepX) /
+                             (double)theRow->stepX;
         }
         if((int)(theRect->xUR + 0.5) % theRow->stepX != 0) {
-          grid[k][col_end - 1].util -=
+          util[col_end - 1] -=
               (200 - (int)(theRect->xUR + 0.5) % theRow->stepX) /
               (double)theRow->stepX;
         }
       }
-    }
-    for(int j = 0; j < theGroup->regions.size(); j++) {
-      rect* theRect = &theGroup->regions[j];
-      int row_start = (int)ceil(theRect->yLL / rowHeight);
-      int row_end = (int)floor(theRect->yUR / rowHeight);
-      for(int k = row_start; k < row_end; k++) {
-        row* theRow = &rows[k];
+      for(int j = 0; j < theGroup->regions.size(); j++) {
+        rect* theRect = &theGroup->regions[j];
+        int row_start = (int)ceil(theRect->yLL / rowHeight);
+        int row_end = (int)floor(theRect->yUR / rowHeight);
+        if(k < row_start || k >= row_end) continue;
+
         int col_start = (int)floor(theRect->xLL / (double)theRow->stepX);
         int col_end = (int)ceil(theRect->xUR / (double)theRow->stepX);
         // assig groupid to each pixel ( grid )
         for(int l = col_start; l < col_end; l++) {
-          if(abs(grid[k][l].util - 1.0) < 1e-6) {
-            grid[k][l].group = group2id[theGroup->name];
-            grid[k][l].linked_cell = NULL;
-            grid[k][l].isValid = true;
-            grid[k][l].util = 1.0;
+          // leave the pixels that don't change unallocated
+          if(util[l] <= 0 || util[l] >= 1 + 1e-6) continue;
+          pixel* thePixel = edit_pixel(l, k);
+          if(abs(util[l] - 1.0) < 1e-6) {
+            thePixel->group = i;
+            thePixel->cell_id = PIXEL_EMPTY;
+            thePixel->setValid(true);
+            util[l] = 1.0;
           }
-          else if(grid[k][l].util > 0 && grid[k][l].util < 1) {
+          else if(util[l] > 0 && util[l] < 1) {
 #ifdef DEBUG2
             cout << "grid[" << k << "][" << l << "]" << endl;
-            cout << "util : " << grid[k][l].util << endl;
+            cout << "util : " << util[l] << endl;
 #endif
-            grid[k][l].linked_cell = &dummy_cell;
-            grid[k][l].util = 0.0;
-            grid[k][l].isValid = false;
+            thePixel->cell_id = PIXEL_DUMMY;
+            thePixel->setValid(false);
+            util[l] = 0.0;
           }
         }
       }
@@ -372,13 +464,22 @@ void circuit::group_pixel_assign() {
   }
   return;
 }
-void circuit::erase_pixel(cell* theCell) {
+// row::cell_list keeps the cells painted on the row in x_pos order
+bool SortByXPos(cell* a, cell* b) { return a->x_pos < b->x_pos; }
+
+void circuit::erase_pixel(cell* theCell, move_journal* journal) {
   if(theCell->isFixed == true || theCell->isPlaced == false) return;
 
   macro* theMacro = &macros[theCell->type];
   int x_step = (int)ceil(theCell->width / wsite);
   int y_step = (int)ceil(theCell->height / rowHeight);
 
+  if(journal != NULL) {
+    move_journal::entry theEntry = {theCell, false, theCell->x_pos,
+                                    theCell->y_pos, theCell->hold};
+    journal->entries.push_back(theEntry);
+  }
+
   theCell->isPlaced = false;
   theCell->hold = false;
 
@@ -386,8 +487,17 @@ void circuit::erase_pixel(cell* theCell) {
   assert(theCell->y_pos == (int)floor(theCell->y_coord / rowHeight + 0.5));
   for(int i = theCell->y_pos; i < theCell->y_pos + y_step; i++) {
     for(int j = theCell->x_pos; j < theCell->x_pos + x_step; j++) {
-      grid[i][j].linked_cell = NULL;
-      grid[i][j].util = 0;
+      edit_pixel(j, i)->cell_id = PIXEL_EMPTY;
+      update_free_site(j, i);
+    }
+    // rows are shared by the groups placed in parallel
+    vector< cell* >& cell_list = rows[i].cell_list;
+#pragma omp critical(row_cell_list)
+    {
+      vector< cell* >::iterator it = std::lower_bound(
+          cell_list.begin(), cell_list.end(), theCell, SortByXPos);
+      assert(it != cell_list.end() && *it == theCell);
+      cell_list.erase(it);
     }
   }
   theCell->x_coord = 0;
@@ -397,8 +507,13 @@ void circuit::erase_pixel(cell* theCell) {
   return;
 }
 
-bool circuit::paint_pixel(cell* theCell, int x_pos, int y_pos) {
+bool circuit::paint_pixel(cell* theCell, int x_pos, int y_pos,
+                          move_journal* journal) {
   assert(theCell->isPlaced == false);
+  if(journal != NULL) {
+    move_journal::entry theEntry = {theCell, true, x_pos, y_pos, false};
+    journal->entries.push_back(theEntry);
+  }
   macro* theMacro = &macros[theCell->type];
   int x_step = (int)ceil(theCell->width / wsite);
   int y_step = (int)ceil(theCell->height / rowHeight);
@@ -409,7 +524,7 @@ bool circuit::paint_pixel(cell* theCell, int x_pos, int y_pos) {
   theCell->y_coord = y_pos * rowHeight;
   theCell->isPlaced = true;
 #ifdef DEBUG
-  cout << "paint cell : " << theCell->name << endl;
+  cout << "paint cell : " << cell_name(theCell) << endl;
   cout << "group : " << theCell->group << endl;
   cout << "init_x_coord - init_y_coord : " << theCell->init_x_coord << " - "
        << theCell->init_y_coord << endl;
@@ -420,31 +535,57 @@ bool circuit::paint_pixel(cell* theCell, int x_pos, int y_pos) {
 #endif
   for(int i = y_pos; i < y_pos + y_step; i++) {
     for(int j = x_pos; j < x_pos + x_step; j++) {
-      if(grid[i][j].linked_cell != NULL) {
+      pixel* thePixel = edit_pixel(j, i);
+      if(thePixel->isEmpty() == false) {
         cerr << " Can't paint grid [" << i << "][" << j << "] !!!" << endl;
-        cerr << " group name : " << groups[grid[i][j].group].name << endl;
-        cerr << " Cell name : " << grid[i][j].linked_cell->name
+        cerr << " group name : " << groups[thePixel->group].name << endl;
+        cerr << " Cell name : " << cell_name(pixel_cell(thePixel))
              << " already occupied grid" << endl;
         exit(2);
         return false;
       }
       else {
-        grid[i][j].linked_cell = theCell;
-        grid[i][j].util = 1.0;
+        thePixel->cell_id = theCell->id;
+        update_free_site(j, i);
       }
     }
+    vector< cell* >& cell_list = rows[i].cell_list;
+#pragma omp critical(row_cell_list)
+    cell_list.insert(std::upper_bound(cell_list.begin(), cell_list.end(),
+                                      theCell, SortByXPos),
+                     theCell);
   }
 
   if( max_cell_height > 1) {
     if(  y_step % 2 == 1) {
       if(rows[y_pos].top_power != theMacro->top_power)
-        theCell->cellorient = "FS";
+        theCell->cellorient = ORIENT_FS;
       else
-        theCell->cellorient = "N";
+        theCell->cellorient = ORIENT_N;
     }
   }
   else {
     theCell->cellorient = rows[y_pos].siteorient;
   }
+  if(net_boxes.empty() == false) {
+#pragma omp critical(net_boxes)
+    update_net_boxes(theCell);
+  }
   return true;
 }
+
+// undo the journal in reverse order, in the pixels the move touched
+void circuit::rollback(move_journal& journal) {
+  for(int i = (int)journal.entries.size() - 1; i >= 0; i--) {
+    move_journal::entry& theEntry = journal.entries[i];
+    if(theEntry.painted) {
+      erase_pixel(theEntry.theCell);
+    }
+    else {
+      paint_pixel(theEntry.theCell, theEntry.x_pos, theEntry.y_pos);
+      theEntry.theCell->hold = theEntry.hold;
+    }
+  }
+  journal.entries.clear();
+  return;
+}
@@ -267,7 +267,7 @@ void circuit::row_check(ofstream& log) {
     cell* theCell = &cells[i];
     if(theCell->isFixed == true) continue;
     if((int)theCell->y_coord % (int)rowHeight != 0) {
-      log << " row_check fail ==> " << theCell->name
+      log << " row_check fail ==> " << cell_name(theCell)
           << "  y_coord : " << theCell->y_coord << endl;
       valid = false;
       count++;
@@ -289,7 +289,7 @@ void circuit::site_check(ofstream& log) {
     cell* theCell = &cells[i];
     if(theCell->isFixed == true) continue;
     if((int)theCell->x_coord % (int)wsite != 0) {
-      log << " site_check fail ==> " << theCell->name
+      log << " site_check fail ==> " << cell_name(theCell)
           << "  x_coord : " << theCell->x_coord << endl;
       valid = false;
       count++;
@@ -310,18 +310,18 @@ void circuit::edge_check(ofstream& log) {
     vector< cell* > cell_list;
     assert(cell_list.size() == 0);
     for(int j = 0; j < rows[i].numSites; j++) {
-      cell* grid_cell = grid[i][j].linked_cell;
-      if(grid[i][j].isValid == false) continue;
-      if(grid_cell != NULL && grid_cell->name != "FIXED_DUMMY") {
+      const pixel* thePixel = get_pixel(j, i);
+      if(thePixel->isValid() == false) continue;
+      if(thePixel->isEmpty() == false && thePixel->cell_id != PIXEL_DUMMY) {
+        cell* grid_cell = pixel_cell(thePixel);
 #ifdef DEBUG
-        cout << "grid util : " << grid[i][j].util << endl;
-        cout << "cell name : " << grid[i][j].linked_cell->name << endl;
+        cout << "cell name : " << cell_name(grid_cell) << endl;
 #endif
         if(cell_list.size() == 0) {
-          cell_list.push_back(grid[i][j].linked_cell);
+          cell_list.push_back(grid_cell);
         }
-        else if(cell_list[cell_list.size() - 1] != grid[i][j].linked_cell) {
-          cell_list.push_back(grid[i][j].linked_cell);
+        else if(cell_list[cell_list.size() - 1] != grid_cell) {
+          cell_list.push_back(grid_cell);
         }
       }
     }
@@ -333,8 +333,8 @@ void circuit::edge_check(ofstream& log) {
 
     for(int k = 0; k < cell_list.size() - 1; k++) {
 #ifdef DEBUG
-      cout << " left cell : " << cell_list[k]->name << endl;
-      cout << " Right cell : " << cell_list[k + 1]->name << endl;
+      cout << " left cell : " << cell_name(cell_list[k]) << endl;
+      cout << " Right cell : " << cell_name(cell_list[k + 1]) << endl;
 #endif
       if(cell_list.size() < 2) continue;
       macro* left_macro = &macros[cell_list[k]->type];
@@ -349,8 +349,8 @@ void circuit::edge_check(ofstream& log) {
       int cell_dist = cell_list[k + 1]->x_coord - cell_list[k]->x_coord -
                       cell_list[k]->width;
       if(cell_dist < space) {
-        log << " edge_check fail ==> " << cell_list[k]->name << " >> "
-            << cell_dist << "(" << space << ") << " << cell_list[k + 1]->name
+        log << " edge_check fail ==> " << cell_name(cell_list[k]) << " >> "
+            << cell_dist << "(" << space << ") << " << cell_name(cell_list[k + 1])
             << endl;
         count++;
       }
@@ -382,7 +382,7 @@ void circuit::power_line_check(ofstream& log) {
     int y_pos = (int)floor(theCell->y_coord / rowHeight + 0.5);
     if(y_size % 2 == 0) {
       if(theMacro->top_power == rows[y_pos].top_power) {
-        log << " power_check fail ( even height ) ==> " << theCell->name
+        log << " power_check fail ( even height ) ==> " << cell_name(theCell)
             << endl;
         valid = false;
         count++;
@@ -390,16 +390,16 @@ void circuit::power_line_check(ofstream& log) {
     }
     else {
       if(theMacro->top_power == rows[y_pos].top_power) {
-        if(theCell->cellorient != "N") {
-          log << " power_check fail ( Should be N ) ==> " << theCell->name
+        if(theCell->cellorient != ORIENT_N) {
+          log << " power_check fail ( Should be N ) ==> " << cell_name(theCell)
               << endl;
           valid = false;
           count++;
         }
       }
       else {
-        if(theCell->cellorient != "FS") {
-          log << " power_check fail ( Should be FS ) ==> " << theCell->name
+        if(theCell->cellorient != ORIENT_FS) {
+          log << " power_check fail ( Should be FS ) ==> " << cell_name(theCell)
               << endl;
           valid = false;
           count++;
@@ -421,7 +421,7 @@ void circuit::placed_check(ofstream& log) {
   for(int i = 0; i < cells.size(); i++) {
     cell* theCell = &cells[i];
     if(theCell->isPlaced == false) {
-      log << " placed_check fail ==> " << theCell->name << endl;
+      log << " placed_check fail ==> " << cell_name(theCell) << endl;
       valid = false;
       count++;
     }
@@ -438,22 +438,9 @@ void circuit::placed_check(ofstream& log) {
 void circuit::overlap_check(ofstream& log) {
   bool valid = true;
   int row = rows.size();
-  pixel** grid_2;
-  grid_2 = new pixel*[row];
-  for(int i = 0; i < row; i++) {
-    int col = rows[i].numSites;
-    grid_2[i] = new pixel[col];
-  }
-
-  for(int i = 0; i < row; i++) {
-    int col = rows[i].numSites;
-    for(int j = 0; j < col; j++) {
-      grid_2[i][j].name = "pixel_" + to_string(i) + "_" + to_string(j);
-      grid_2[i][j].y_pos = i;
-      grid_2[i][j].x_pos = j;
-      grid_2[i][j].linked_cell = NULL;
-    }
-  }
+  int col = grid.num_cols();
+  // occupying cell index per site, row-major
+  vector< unsigned > grid_2(static_cast< size_t >(row) * col, PIXEL_EMPTY);
 
   for(int i = 0; i < cells.size(); i++) {
     cell* theCell = &cells[i];
@@ -489,13 +476,13 @@ void circuit::overlap_check(ofstream& log) {
 
     for(int j = y_pos; j < y_ur; j++) {
       for(int k = x_pos; k < x_ur; k++) {
-        if(grid_2[j][k].linked_cell == NULL) {
-          grid_2[j][k].linked_cell = theCell;
-          grid_2[j][k].util = 1.0;
+        unsigned& occupant = grid_2[static_cast< size_t >(j) * col + k];
+        if(occupant == PIXEL_EMPTY) {
+          occupant = theCell->id;
         }
         else {
-          log << "overlap_check ==> FAIL!! ( cell " << theCell->name
-              << " is overlap with " << grid_2[j][k].linked_cell->name << " ) "
+          log << "overlap_check ==> FAIL!! ( cell " << cell_name(theCell)
+              << " is overlap with " << cell_names[occupant] << " ) "
               << " ( " 
               << IntConvert(k*wsite + core.xLL) << ", " 
               << IntConvert(j*rowHeight + core.yLL) << " )" 
@@ -2,6 +2,10 @@
       
 opendp::circuit::circuit() 
 : GROUP_IGNORE(false),
+        engine(ENGINE_PIXEL),
+        def_reader(DEF_READER_SI2),
+        seed(777),
+        hpwl_weight(0.0),
         num_fixed_nodes(0),
         num_cpu(1),
         DEFVersion(""),
@@ -15,6 +19,7 @@ opendp::circuit::circuit()
         max_utilization(100.0),
         wsite(0),
         max_cell_height(1),
+        cached_hpwl(0),
         rowHeight(0.0f), 
         fileOut(0) {
 
@@ -23,22 +28,4 @@ opendp::circuit::circuit()
     rows.reserve(4096);
     sub_regions.reserve(100);
 
-#ifdef USE_GOOGLE_HASH
-    macro2id.set_empty_key(
-        INITSTR); /* OPENDP_HASH_MAP between macro name and ID */
-    cell2id.set_empty_key(
-        INITSTR); /* OPENDP_HASH_MAP between cell  name and ID */
-    pin2id.set_empty_key(
-        INITSTR); /* OPENDP_HASH_MAP between pin   name and ID */
-    net2id.set_empty_key(
-        INITSTR); /* OPENDP_HASH_MAP between net   name and ID */
-    row2id.set_empty_key(
-        INITSTR); /* OPENDP_HASH_MAP between row   name and ID */
-    site2id.set_empty_key(
-        INITSTR); /* OPENDP_HASH_MAP between site  name and ID */
-    layer2id.set_empty_key(
-        INITSTR); /* OPENDP_HASH_MAP between layer name and ID */
-    via2id.set_empty_key(INITSTR);
-    group2id.set_empty_key(INITSTR); /* group between name -> index */
-#endif
 };
@@ -51,6 +51,8 @@
 #include <limits>
 #include <assert.h>
 #include <queue>
+#include <memory>
+#include <stdexcept>
 #include <omp.h>
 #include "mymeasure.h"
 
@@ -80,6 +82,43 @@ OPENDP_NAMESPACE_OPEN
 
 enum power { VDD, VSS };
 
+// legalization engine, -legalizer pixel | abacus
+enum legal_engine { ENGINE_PIXEL, ENGINE_ABACUS };
+
+// DEF reader, -def_reader si2 | mmap
+enum def_reader_type { DEF_READER_SI2, DEF_READER_MMAP };
+
+// the position of a cell a move or a check starts from : init_x_coord /
+// init_y_coord, x_coord / y_coord, or x_pos / y_pos in sites and rows.
+// circuit::mode_coord reads it
+enum coord_mode { MODE_INIT_COORD, MODE_COORD, MODE_POS };
+
+// placement orientation, in the order of the DEF parser's orient index
+// ( defiComponent::placementOrient, defiRow::orient )
+enum orient {
+  ORIENT_N,
+  ORIENT_W,
+  ORIENT_S,
+  ORIENT_E,
+  ORIENT_FN,
+  ORIENT_FW,
+  ORIENT_FS,
+  ORIENT_FE
+};
+
+// LEF macro CLASS. CLASS_CORE is a plain CORE, CORE with a sub class
+// ( FEEDTHRU, TIEHIGH, SPACER, ... ) is CLASS_CORE_OTHER
+enum macro_class {
+  CLASS_CORE,
+  CLASS_CORE_OTHER,
+  CLASS_BLOCK,
+  CLASS_PAD,
+  CLASS_COVER,
+  CLASS_RING,
+  CLASS_ENDCAP,
+  CLASS_UNKNOWN
+};
+
 template < class T >
 using max_heap = std::priority_queue< T >;
 
@@ -94,6 +133,154 @@ struct rect {
   void dump() { printf("%f : %f - %f : %f\n", xLL, yLL, xUR, yUR); }
 };
 
+// a name : a character range, '\0' terminated when it is from a
+// name_arena. The default one is the empty key of name_map
+struct name_view {
+  const char* data;
+  unsigned size;
+  name_view() : data(NULL), size(0) {}
+  name_view(const char* str) : data(str), size(strlen(str)) {}
+  name_view(const std::string& str) : data(str.c_str()), size(str.size()) {}
+  name_view(const char* str, unsigned length) : data(str), size(length) {}
+  const char* c_str() const { return data ? data : ""; }
+  std::string str() const { return std::string(c_str(), size); }
+  bool operator==(const name_view& other) const {
+    return size == other.size && memcmp(data, other.data, size) == 0;
+  }
+};
+std::ostream& operator<<(std::ostream& os, const name_view& name);
+
+// append only storage of names. Blocks are neither moved nor freed before
+// the arena, so the views it hands out stay valid
+class name_arena {
+ public:
+  name_arena() : used_(0), capacity_(0), memory_(0) {}
+  ~name_arena();
+  name_view intern(const name_view& name);
+  size_t memory_usage() const { return memory_; }
+
+ private:
+  name_arena(const name_arena&) = delete;
+  name_arena& operator=(const name_arena&) = delete;
+  std::vector< char* > blocks_;
+  size_t used_;
+  size_t capacity_;
+  size_t memory_;
+};
+
+// open addressing hash table, linear probing over a power of two number of
+// slots, at most half full. Key_ops gives hash( key ), equal( a, b ),
+// empty_key() for the free slots and empty( key ). Entries move when the
+// table grows
+template < class Key, class Key_ops >
+class flat_map {
+ public:
+  struct entry {
+    Key first;
+    unsigned second;
+  };
+  typedef entry* iterator;
+
+  flat_map() : size_(0) {}
+
+  size_t size() const { return size_; }
+  size_t memory_usage() const { return slots_.capacity() * sizeof(entry); }
+  iterator end() { return NULL; }
+  iterator find(const Key& key) {
+    if(slots_.empty()) return end();
+    size_t mask = slots_.size() - 1;
+    for(size_t i = Key_ops::hash(key) & mask;; i = (i + 1) & mask) {
+      if(Key_ops::empty(slots_[i].first)) return end();
+      if(Key_ops::equal(slots_[i].first, key)) return &slots_[i];
+    }
+  }
+  // key must not be in the table
+  iterator insert_new(const Key& key, unsigned value) {
+    if(2 * (size_ + 1) > slots_.size())
+      rehash(slots_.empty() ? 16 : 2 * slots_.size());
+    size_++;
+    return place(key, value);
+  }
+  void reserve(size_t n) {
+    size_t num_slots = 16;
+    while(num_slots < 2 * n) num_slots *= 2;
+    if(num_slots > slots_.size()) rehash(num_slots);
+  }
+
+ private:
+  iterator place(const Key& key, unsigned value) {
+    size_t mask = slots_.size() - 1;
+    size_t i = Key_ops::hash(key) & mask;
+    while(!Key_ops::empty(slots_[i].first)) i = (i + 1) & mask;
+    slots_[i].first = key;
+    slots_[i].second = value;
+    return &slots_[i];
+  }
+  void rehash(size_t num_slots) {
+    entry free_slot = {Key_ops::empty_key(), 0};
+    std::vector< entry > old_slots(num_slots, free_slot);
+    old_slots.swap(slots_);
+    for(size_t i = 0; i < old_slots.size(); i++)
+      if(!Key_ops::empty(old_slots[i].first))
+        place(old_slots[i].first, old_slots[i].second);
+  }
+
+  std::vector< entry > slots_;
+  size_t size_;
+};
+
+struct name_ops {
+  static size_t hash(const name_view& key);
+  static bool equal(const name_view& a, const name_view& b) { return a == b; }
+  static name_view empty_key() { return name_view(); }
+  static bool empty(const name_view& key) { return key.data == NULL; }
+};
+
+// name -> index map. The keys are interned in the map's own arena, so a
+// name added from a temporary stays valid and is stored once
+class name_map : public flat_map< name_view, name_ops > {
+ public:
+  std::pair< iterator, bool > insert(const name_view& key, unsigned value) {
+    iterator it = find(key);
+    if(it != end()) return std::make_pair(it, false);
+    return std::make_pair(insert_new(names_.intern(key), value), true);
+  }
+  // like std::unordered_map, a missing name is added with index 0
+  unsigned& operator[](const name_view& key) {
+    return insert(key, 0).first->second;
+  }
+  unsigned at(const name_view& key) {
+    iterator it = find(key);
+    if(it == end()) throw std::out_of_range(key.str());
+    return it->second;
+  }
+  size_t memory_usage() const {
+    return flat_map< name_view, name_ops >::memory_usage() +
+           names_.memory_usage();
+  }
+
+ private:
+  name_arena names_;
+};
+
+// an instance pin by ( cell index << 32 | macro_pin::id )
+typedef unsigned long long pin_key;
+struct pin_key_ops {
+  // 64 bit finalizer of MurmurHash3, the cell index reaches the low bits
+  static size_t hash(pin_key key) {
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDULL;
+    key ^= key >> 33;
+    key *= 0xC4CEB9FE1A85EC53ULL;
+    key ^= key >> 33;
+    return (size_t)key;
+  }
+  static bool equal(pin_key a, pin_key b) { return a == b; }
+  static pin_key empty_key() { return ULLONG_MAX; }
+  static bool empty(pin_key key) { return key == ULLONG_MAX; }
+};
+typedef flat_map< pin_key, pin_key_ops > pin_key_map;
+
 struct site {
   std::string name;
   double width;                /* in microns */
@@ -182,18 +369,19 @@ struct via {
 };
 
 struct macro_pin {
+  unsigned id; /* index among the macro's pins, for pin_key */
   std::string direction;
 
   std::vector< rect > port;
   std::vector< unsigned > layer;
 
   std::string shape;
-  macro_pin() : direction(""), shape(""), layer(0) {}
+  macro_pin() : id(UINT_MAX), direction(""), shape(""), layer(0) {}
 };
 
 struct macro {
   std::string name;
-  std::string type;        /* equivalent to class, I/O pad or CORE */
+  macro_class type;   /* equivalent to class, I/O pad or CORE */
   bool isFlop;        /* clocked element or not */
   bool isMulti;       /* single row = false , multi row = true */
   double xOrig;       /* in microns */
@@ -211,7 +399,7 @@ struct macro {
 
   macro()
       : name(""),
-        type(""),
+        type(CLASS_UNKNOWN),
         isFlop(false),
         isMulti(false),
         xOrig(0.0),
@@ -229,7 +417,7 @@ struct macro {
 
 struct pin {
   // from verilog
-  std::string name; /* Name of pins : instance name + "_" + port_name */
+  name_view name; /* IO pins only, instance pins are found by pin_key */
   unsigned id;
   unsigned owner; /* The owners of PIs or POs are UINT_MAX */
   unsigned net;
@@ -244,8 +432,7 @@ struct pin {
   bool isFixed; /* is this node fixed? */
 
   pin()
-      : name(""),
-        id(UINT_MAX),
+      : id(UINT_MAX),
         owner(UINT_MAX),
         net(UINT_MAX),
         type(UINT_MAX),
@@ -259,32 +446,29 @@ struct pin {
   void print();
 };
 
+// the placement record of a cell, kept small for the loops over all cells.
+// The name is in circuit::cell_names ( circuit::cell_name )
 struct cell {
-  std::string name;
   unsigned id;
   unsigned type;                  /* index to some predefined macro */
   int x_coord, y_coord;           /* (in DBU) */
   int init_x_coord, init_y_coord; /* (in DBU) */
   int x_pos, y_pos;               /* (in DBU) */
   double width, height;           /* (in DBU) */
-  bool isFixed;                   /* fixed cell or not */
-  bool isPlaced;
-  bool inGroup;
-  bool hold;
   unsigned region;
-  OPENDP_HASH_MAP< std::string, unsigned > ports; /* <port name, index to the pin> */
-  std::string cellorient;
-  std::string group;
-
-  double dense_factor;
-  int dense_factor_count;
+  unsigned group; /* index to circuit::groups, UINT_MAX if not in a group */
   unsigned binId;
+  orient cellorient;
+  double dense_factor;
   double disp;
+  bool isFixed : 1; /* fixed cell or not */
+  bool isPlaced : 1;
+  bool inGroup : 1;
+  bool hold : 1;
 
   cell()
-      : name(""),
+      : id(UINT_MAX),
         type(UINT_MAX),
-        id(UINT_MAX),
         x_coord(0),
         y_coord(0),
         init_x_coord(0),
@@ -293,49 +477,247 @@ struct cell {
         y_pos(INT_MAX),
         width(0.0),
         height(0.0),
+        region(UINT_MAX),
+        group(UINT_MAX),
+        binId(UINT_MAX),
+        cellorient(ORIENT_N),
+        dense_factor(0.0),
+        disp(0.0),
         isFixed(false),
         isPlaced(false),
         inGroup(false),
-        hold(false),
-        region(UINT_MAX),
-        cellorient(""),
-        group(""),
-        dense_factor(0.0),
-        dense_factor_count(0),
-        binId(UINT_MAX),
-        disp(0.0) {
-#ifdef USE_GOOGLE_HASH
-    ports.set_empty_key(INITSTR);
-#endif
-  }
+        hold(false) {}
   void print();
 };
 
+// a COMPONENTS entry of the input DEF, recorded by ReadDef so write_def
+// does not parse the DEF again. The placement is the cell's; the rest of
+// the entry is kept as text, in circuit::def_component_texts
+struct def_component {
+  unsigned cell;       /* index to circuit::cells */
+  unsigned char status; /* DEFI_COMPONENT_*, 0 if none */
+  unsigned nets;       /* text after the macro name, UINT_MAX if none */
+  unsigned attributes; /* text after the placement, UINT_MAX if none */
+};
+
+// pixel.cell_id sentinels; any other value is an index to circuit::cells
+#define PIXEL_EMPTY UINT_MAX
+#define PIXEL_DUMMY (UINT_MAX - 1) /* blocked by fence boundary, see dummy_cell */
+#define PIXEL_NO_GROUP USHRT_MAX
+
+// pixel.flags
+#define PIXEL_VALID 0x1
+
+// one placement site. Coordinates are implied by the position in pixel_grid
+// and the name ( pixel_<y>_<x> ) is never stored.
 struct pixel {
-  std::string name;
-  double util;
-  int x_pos;
-  int y_pos;
-  unsigned group;  // group id
+  unsigned cell_id;     // linked cell index, PIXEL_EMPTY or PIXEL_DUMMY
+  unsigned short group; // group id, PIXEL_NO_GROUP outside fence regions
+  unsigned char flags;  // PIXEL_VALID is cleared for dummy place
+
+  pixel() : cell_id(PIXEL_EMPTY), group(PIXEL_NO_GROUP), flags(PIXEL_VALID) {}
+  bool isEmpty() const { return cell_id == PIXEL_EMPTY; }
+  bool isValid() const { return flags & PIXEL_VALID; }
+  void setValid(bool valid) {
+    flags = valid ? (flags | PIXEL_VALID) : (flags & ~PIXEL_VALID);
+  }
+};
 
-  cell* linked_cell;
-  bool isValid;  // false for dummy place
-  pixel()
-      : name(""),
-        util(0.0),
-        x_pos(0.0),
-        y_pos(0.0),
-        group(UINT_MAX),
-        linked_cell(NULL),
-        isValid(true) {}
+// Pixel storage cut into TILE_ROWS x TILE_COLS tiles. A tile is allocated on
+// the first edit_pixel() inside it; until then, and again after
+// share_tile(), it points to one of two shared read-only tiles:
+//  - INVALID_TILE : every pixel is the fill pixel given to init()
+//                   ( no row, i.e. invalid )
+//  - BLOCKED_TILE : every pixel is invalid and taken by the dummy cell
+//                   ( interior of a fixed macro )
+// so dies that are mostly outside of rows or under macros only pay for the
+// tile directory there.
+class pixel_grid {
+ public:
+  static const int TILE_ROWS = 16;
+  static const int TILE_COLS = 64;
+  enum shared_tile { INVALID_TILE, BLOCKED_TILE };
+
+  pixel_grid() : num_rows_(0), num_cols_(0), tiles_x_(0), tiles_y_(0) {}
+
+  void init(int num_rows, int num_cols, const pixel& fill);
+  size_t memory_usage() const;
+  int num_allocated_tiles() const;
+
+  int num_rows() const { return num_rows_; }
+  int num_cols() const { return num_cols_; }
+  int tiles_x() const { return tiles_x_; }
+  int tiles_y() const { return tiles_y_; }
+
+  const pixel* at(int x_pos, int y_pos) const {
+    return &tiles_[tile_index(x_pos, y_pos)][pixel_index(x_pos, y_pos)];
+  }
+  pixel* edit(int x_pos, int y_pos) {
+    int tile = tile_index(x_pos, y_pos);
+    if(!owned_[tile]) allocate_tile(tile);
+    return &owned_[tile][pixel_index(x_pos, y_pos)];
+  }
+
+  bool is_shared(int tile_x, int tile_y) const {
+    return !owned_[tile_y * tiles_x_ + tile_x];
+  }
+  bool is_blocked(int x_pos, int y_pos) const {
+    return tiles_[tile_index(x_pos, y_pos)] == &blocked_tile_[0];
+  }
+  // releases the tile and points it to a shared one
+  void share_tile(int tile_x, int tile_y, shared_tile type);
+
+ private:
+  int tile_index(int x_pos, int y_pos) const {
+    return (y_pos / TILE_ROWS) * tiles_x_ + x_pos / TILE_COLS;
+  }
+  int pixel_index(int x_pos, int y_pos) const {
+    return (y_pos % TILE_ROWS) * TILE_COLS + x_pos % TILE_COLS;
+  }
+  void allocate_tile(int tile);
+
+  int num_rows_;
+  int num_cols_;
+  int tiles_x_;
+  int tiles_y_;
+  std::vector< const pixel* > tiles_;
+  std::vector< std::unique_ptr< pixel[] > > owned_;
+  std::vector< pixel > invalid_tile_;
+  std::vector< pixel > blocked_tile_;
+};
+
+// Free sites of one placement class ( the non-group cells, or the cells of one
+// fence group ) as one bit per site, set = the pixel is empty, valid and
+// belongs to the class. Only the window of rows / columns the class can
+// occupy is stored; the window starts on a word boundary so that a word
+// covers the same sites in every row and multi-row footprints are tested by
+// AND-ing the rows word by word.
+//
+// Each row also keeps a free segment index: a segment tree over its words
+// holding the free run lengths ( prefix, suffix, longest ) of every node, so
+// the first / last run of a given width around a site is found in
+// O(log n). The trees are cut into blocks of at most 64 words ( 4096 sites )
+// whose roots are visited in order; updates inside one block never touch
+// another block.
+class free_site_map {
+ public:
+  typedef unsigned long long word_t;
+  static const int WORD_BITS = 64;
+
+  free_site_map()
+      : x_begin_(0),
+        y_begin_(0),
+        x_end_(0),
+        y_end_(0),
+        words_per_row_(0),
+        tree_words_(1),
+        blocks_per_row_(0),
+        cap_tiles_(0) {}
+
+  void init(int x_begin, int y_begin, int x_end, int y_end);
+  size_t memory_usage() const {
+    size_t usage = words_.capacity() * sizeof(word_t) +
+                   runs_.capacity() * sizeof(run_summary);
+    for(size_t i = 0; i < capacity_.size(); i++)
+      usage += capacity_[i].capacity() * sizeof(run_summary);
+    return usage;
+  }
+
+  bool contains(int x_pos, int y_pos) const {
+    return x_pos >= x_begin_ && x_pos < x_end_ && y_pos >= y_begin_ &&
+           y_pos < y_end_;
+  }
+  int x_begin() const { return x_begin_; }
+  int x_end() const { return x_end_; }
+  int y_begin() const { return y_begin_; }
+  int y_end() const { return y_end_; }
+
+  bool is_free(int x_pos, int y_pos) const;
+  void set_free(int x_pos, int y_pos, bool free);
+
+  // all sites of [x_pos, x_pos + width) x [y_pos, y_pos + height) are free
+  bool is_free(int x_pos, int y_pos, int width, int height) const;
+
+  // lowest / highest x in [x_first, x_last] where a width x height footprint
+  // at row y_pos is free, -1 if there is none
+  int find_first(int x_first, int x_last, int y_pos, int width,
+                 int height) const;
+  int find_last(int x_first, int x_last, int y_pos, int width,
+                int height) const;
+
+  // maximal free runs [begin, end) of row y_pos, in increasing x
+  void free_runs(int y_pos, std::vector< std::pair< int, int > >& runs) const;
+
+  // the capacity tiles over [x_first, x_last] of row y_pos may hold a free
+  // run of width sites. false means there is none in [x_first, x_last]
+  bool has_room(int x_first, int x_last, int y_pos, int width) const;
+  // nearest row from y_pos towards y_limit ( both inclusive ) passing
+  // has_room, saturated row bands are skipped whole. -1 if there is none
+  int next_room_row(int x_first, int x_last, int y_pos, int y_limit,
+                    int width) const;
+
+ private:
+  // free run lengths of a segment tree node, in sites
+  struct run_summary {
+    unsigned short prefix;
+    unsigned short suffix;
+    unsigned short longest;
+    run_summary() : prefix(0), suffix(0), longest(0) {}
+  };
+  static const int MAX_TREE_WORDS = 64;
+
+  run_summary* tree(int y, int block) {
+    return &runs_[(static_cast< size_t >(y) * blocks_per_row_ + block) * 2 *
+                  tree_words_];
+  }
+  const run_summary* tree(int y, int block) const {
+    return &runs_[(static_cast< size_t >(y) * blocks_per_row_ + block) * 2 *
+                  tree_words_];
+  }
+  void update_runs(int y, int wi);
+
+  // first / last start of a free run of width sites in row y, searched
+  // through the free segment index, map local indices
+  int run_first(int y, int from, int last, int width) const;
+  int run_last(int y, int first, int from, int width) const;
+  int node_first(const run_summary* nodes, int y, int node, int lo, int len,
+                 int from, int last, int width, int& run) const;
+  int node_last(const run_summary* nodes, int y, int node, int lo, int len,
+                int first, int from, int width, int& run) const;
+
+  // AND of the word wi of rows [y, y + height), map local indices
+  word_t row_word(int y, int height, int wi) const;
+  // map local bit search on the AND of rows [y, y + height), limits inclusive
+  int next_free(int y, int height, int from, int last) const;
+  int next_used(int y, int height, int from, int last) const;
+  int prev_free(int y, int height, int from, int first) const;
+  int prev_used(int y, int height, int from, int first) const;
+
+  // capacity pyramid : free run summaries of CAP_TILE_WORDS wide tiles.
+  // level 0 holds the tiles of every row, level l the field wise maximum
+  // over bands of 2^l rows, which bounds the runs of each row in the band
+  static const int CAP_TILE_WORDS = 2;
+  static const int CAP_MAX_LEVEL = 10;
+  void update_capacity(int y, int tile);
+  int band_longest(int level, int band, int t_first, int t_last) const;
+
+  int x_begin_, y_begin_;
+  int x_end_, y_end_;
+  int words_per_row_;
+  int tree_words_;
+  int blocks_per_row_;
+  std::vector< word_t > words_;
+  std::vector< run_summary > runs_;
+  int cap_tiles_;
+  std::vector< std::vector< run_summary > > capacity_;
 };
 
 struct net {
-  std::string name;
+  name_view name; /* in net2id */
   unsigned source;          /* input pin index to the net */
   std::vector< unsigned > sinks; /* sink pins indices of the net */
 
-  net() : name(""), source(UINT_MAX) {}
+  net() : source(UINT_MAX) {}
   void print();
 };
 
@@ -348,7 +730,7 @@ struct row {
   int stepX; /* (in DBU) */
   int stepY; /* (in DBU) */
   int numSites;
-  std::string siteorient;
+  orient siteorient;
   power top_power;
 
   std::vector< cell* > cell_list;
@@ -361,7 +743,7 @@ struct row {
         stepX(0),
         stepY(0),
         numSites(0),
-        siteorient("") {}
+        siteorient(ORIENT_N) {}
   void print();
 };
 
@@ -404,6 +786,107 @@ struct density_bin {
   void print();
 };
 
+// legal start rows of a footprint class ( row span, top power ). even
+// spans need the opposite top power on their first row, every span has to
+// end below the die top
+struct start_row_mask {
+  std::vector< char > legal;
+  std::vector< int > next_legal; /* lowest legal row >= y, -1 if none */
+  std::vector< int > prev_legal; /* highest legal row <= y, -1 if none */
+};
+
+// what the refinement passes of one cell list did
+struct refine_stats {
+  std::vector< int > pass_moved; /* cells moved by each assignment pass */
+  int swap_attempts;             /* same footprint pairs evaluated */
+  int swap_accepted;
+  refine_stats() : swap_attempts(0), swap_accepted(0) {}
+};
+
+// everything evaluation() reports, from one pass over the cells and one
+// over the nets
+struct placement_metrics {
+  int num_cells;
+  double sum_disp;
+  double max_disp;
+  cell* max_cell;
+  double placed_disp; /* cells left at ( 0, 0 ) are skipped */
+  double init_hpwl;   /* at the initial coordinates */
+  double hpwl;
+  std::vector< int > group_cells; /* per group, by circuit::groups index */
+  std::vector< double > group_sum_disp;
+  std::vector< double > group_max_disp;
+  placement_metrics()
+      : num_cells(0),
+        sum_disp(0.0),
+        max_disp(0.0),
+        max_cell(NULL),
+        placed_disp(0.0),
+        init_hpwl(0.0),
+        hpwl(0.0) {}
+};
+
+// bounding box of a net's pins ( in DBU ), with the number of pins on each
+// side
+struct net_box {
+  long long xLL, xUR, yLL, yUR;
+  int n_xLL, n_xUR, n_yLL, n_yUR;
+  net_box()
+      : xLL(LLONG_MAX),
+        xUR(LLONG_MIN),
+        yLL(LLONG_MAX),
+        yUR(LLONG_MIN),
+        n_xLL(0),
+        n_xUR(0),
+        n_yLL(0),
+        n_yUR(0) {}
+  void add(long long x, long long y) {
+    if(x < xLL) xLL = x, n_xLL = 0;
+    if(x == xLL) n_xLL++;
+    if(x > xUR) xUR = x, n_xUR = 0;
+    if(x == xUR) n_xUR++;
+    if(y < yLL) yLL = y, n_yLL = 0;
+    if(y == yLL) n_yLL++;
+    if(y > yUR) yUR = y, n_yUR = 0;
+    if(y == yUR) n_yUR++;
+  }
+  long long hpwl() const {
+    return (n_xLL == 0) ? 0 : xUR - xLL + yUR - yLL;
+  }
+};
+
+// a cell and the position ( in DBU ) it would be moved to
+struct cell_move {
+  cell* theCell;
+  int x_coord;
+  int y_coord;
+};
+
+// a pin of a moved cell : its net and its position ( in DBU ) before and
+// after the move
+struct moved_pin {
+  unsigned net_id;
+  int x_coord, y_coord;
+  int new_x, new_y;
+  bool operator<(const moved_pin& other) const {
+    return net_id < other.net_id;
+  }
+};
+
+// paint / erase operations of a compound move, in order. circuit::rollback
+// undoes them in reverse, commit keeps them
+struct move_journal {
+  struct entry {
+    cell* theCell;
+    bool painted; /* painted at ( x_pos, y_pos ), else erased from there */
+    int x_pos;
+    int y_pos;
+    bool hold; /* hold flag before an erase */
+  };
+  std::vector< entry > entries;
+  void commit() { entries.clear(); }
+};
+
 struct track {
   std::string axis;  // X or Y
   unsigned start;
@@ -416,28 +899,26 @@ struct track {
 class circuit {
  public:
   bool GROUP_IGNORE;
+  legal_engine engine;
+  def_reader_type def_reader;
+  unsigned seed;  // -seed, random choices of the refinement passes
+  double hpwl_weight;  // -hpwl_weight, HPWL change in the swap cost
 
   void init_large_cell_stor();
-  OPENDP_HASH_MAP< std::string, unsigned >
-      macro2id; /* OPENDP_HASH_MAP between macro name and ID */
-  OPENDP_HASH_MAP< std::string, unsigned >
-      cell2id; /* OPENDP_HASH_MAP between cell  name and ID */
-  OPENDP_HASH_MAP< std::string, unsigned >
-      pin2id; /* OPENDP_HASH_MAP between pin   name and ID */
-  OPENDP_HASH_MAP< std::string, unsigned >
-      net2id; /* OPENDP_HASH_MAP between net   name and ID */
-  OPENDP_HASH_MAP< std::string, unsigned >
-      row2id; /* OPENDP_HASH_MAP between row   name and ID */
-  OPENDP_HASH_MAP< std::string, unsigned >
-      site2id; /* OPENDP_HASH_MAP between site  name and ID */
-  OPENDP_HASH_MAP< std::string, unsigned >
-      layer2id; /* OPENDP_HASH_MAP between layer name and ID */
-
-  OPENDP_HASH_MAP< std::string, unsigned > via2id;
+  name_map macro2id; /* name_map between macro name and ID */
+  name_map cell2id;  /* name_map between cell  name and ID */
+  name_map pin2id;   /* name_map between IO pin name and ID */
+  pin_key_map inst_pin2id; /* pin_key of an instance pin -> ID */
+  name_map net2id;   /* name_map between net   name and ID */
+  name_map row2id;   /* name_map between row   name and ID */
+  name_map site2id;  /* name_map between site  name and ID */
+  name_map layer2id; /* name_map between layer name and ID */
+
+  name_map via2id;
   std::map< std::pair< int, int >, double > edge_spacing; /* spacing OPENDP_HASH_MAP
                                                    between edges  1 to 1 , 1 to
                                                    2, 2 to 2 */
-  OPENDP_HASH_MAP< std::string, unsigned > group2id; /* group between name -> index */
+  name_map group2id; /* group between name -> index */
 
   double design_util;
   double sum_displacement;
@@ -464,12 +945,43 @@ class circuit {
 
   std::string out_def_name;
   std::string in_def_name;
+  std::string eco_def_name; /* previous legal DEF of -eco_def */
+  /* cell positions in eco_def_name, ( -1, -1 ) if not there as the same macro */
+  std::vector< std::pair< double, double > > eco_coords;
+  /* COMPONENTS of in_def_name in file order, for write_def */
+  std::vector< def_component > def_components;
+  std::vector< std::string > def_component_texts;
 
   /* benchmark generation */
   std::string benchmark; /* benchmark name */
 
+  // nets as compressed sparse rows, built after parsing. pins of net i are
+  // [ net_pin_start[i], net_pin_start[i + 1] ), at x[ net_pin_owner ] +
+  // net_pin_x ( DBU ) over a coordinate array of the cells. IO pins are
+  // owned by the extra entry cells.size(), at ( 0, 0 )
+  std::vector< unsigned > net_pin_start;
+  std::vector< unsigned > net_pin_owner;
+  std::vector< int > net_pin_x;
+  std::vector< int > net_pin_y;
+
+  // net bounding boxes, empty unless init_net_boxes() was called. pins of
+  // cell i are [ cell_pin_start[i], cell_pin_start[i + 1] ) in
+  // cell_pin_nets / cell_pin_offsets
+  std::vector< net_box > net_boxes;
+  std::vector< unsigned > cell_pin_start;
+  std::vector< unsigned > cell_pin_nets;
+  std::vector< std::pair< int, int > > cell_pin_offsets;
+  // cell positions the boxes have seen, and the IO owner entry
+  std::vector< std::pair< int, int > > box_coords;
+  long long cached_hpwl;                           /* sum of net_boxes */
+  std::vector< moved_pin > box_pins; /* moved_pins() scratch */
+
   // 2D - pixel grid;
-  pixel** grid;
+  pixel_grid grid;
+  // free sites per placement class, groups.size() is the non-group class
+  std::vector< free_site_map > free_sites;
+  // start rows per footprint class, ( row span * 2 + top power )
+  std::vector< start_row_mask > start_rows;
   cell dummy_cell;
   std::vector< sub_region > sub_regions;
   std::vector< track > tracks;
@@ -497,6 +1009,7 @@ class circuit {
   std::vector< layer > layers; /* layer list */
   std::vector< macro > macros; /* macro list */
   std::vector< cell > cells;   /* cell list */
+  std::vector< name_view > cell_names; /* by cell id, in cell2id */
   std::vector< net > nets;     /* net list */
   std::vector< pin > pins;     /* pin list */
   
@@ -511,14 +1024,16 @@ class circuit {
 
   /* locateOrCreate helper functions - parser_helper.cpp */
   macro* locateOrCreateMacro(const std::string& macroName);
-  cell* locateOrCreateCell(const std::string& cellName);
-  net* locateOrCreateNet(const std::string& netName);
-  pin* locateOrCreatePin(const std::string& pinName);
+  cell* locateOrCreateCell(name_view cellName);
+  net* locateOrCreateNet(name_view netName);
+  pin* locateOrCreatePin(name_view pinName);
+  pin* locateOrCreatePin(unsigned owner, unsigned macro_pin_id);
   row* locateOrCreateRow(const std::string& rowName);
   site* locateOrCreateSite(const std::string& siteName);
   layer* locateOrCreateLayer(const std::string& layerName);
   via* locateOrCreateVia(const std::string& viaName);
   group* locateOrCreateGroup(const std::string& groupName);
+  name_view cell_name(const cell* theCell);
   void print();
 
   /* IO helpers for LEF - parser.cpp */
@@ -544,7 +1059,7 @@ class circuit {
   void read_def_groups(std::ifstream& is);
   void write_def(const std::string& output);
 
-  void WriteDefComponents(const std::string& inputDef);
+  void WriteDefComponents();
 
   FILE* fileOut;
 
@@ -564,7 +1079,26 @@ class circuit {
 
 
   // Si2 parsing engine
-  int ReadDef(const std::string& input);
+  int ReadDef(const std::string& input,
+      size_t (*read_func)(FILE*, char*, size_t) = NULL);
+  void ReadEcoDef(const std::string& input);
+
+  /* DEF records, from the Si2 callbacks and the mmap reader -
+   * circuitParser.cpp */
+  void add_def_component(name_view id, name_view macro_name, int status,
+                         int x, int y, int orient, const std::string& nets,
+                         const std::string& attributes);
+  void add_def_pin(name_view name, name_view direction, bool fixed, int x,
+                   int y);
+  unsigned add_def_net(name_view name);
+  void add_def_net_pin(unsigned net_id, name_view instance, name_view pin_name,
+                       bool source);
+  void add_def_region(name_view name, const std::vector< rect >& rects,
+                      name_view type);
+  void add_def_group_member(group* theGroup, name_view member);
+
+  /* mmap DEF reader with Si2 fallback - def_reader.cpp */
+  int read_def_mmap(const std::string& input);
   // int DefVersionCbk(defrCallbackType_e c, const char* versionName, defiUserData ud);
   // int DefDividerCbk(defrCallbackType_e c, const char* h, defiUserData ud);
   // int DefDesignCbk(defrCallbackType_e c, const char* std::string, defiUserData ud);
@@ -578,48 +1112,74 @@ class circuit {
 
   // utility.cpp - By SGD
   void power_mapping();
+  void init_start_rows();
+  const start_row_mask* cell_start_rows(cell* theCell);
   void evaluation();
-  double Disp();
-  double HPWL(std::string mode);
+  placement_metrics measure_metrics();
   double calc_density_factor(double unit);
 
   void group_analyze();
+  // the position of theCell mode starts from, in DBU
+  std::pair< int, int > mode_coord(const cell* theCell, coord_mode mode) {
+    if(mode == MODE_COORD)
+      return std::make_pair(theCell->x_coord, theCell->y_coord);
+    if(mode == MODE_POS)
+      return std::make_pair(theCell->x_pos * wsite,
+                            (int)(theCell->y_pos * rowHeight));
+    return std::make_pair(theCell->init_x_coord, theCell->init_y_coord);
+  }
   std::pair< int, int > nearest_coord_to_rect_boundary(cell* theCell, rect* theRect,
-                                                  std::string mode);
-  int dist_for_rect(cell* theCell, rect* theRect, std::string mode);
+                                                  coord_mode mode);
+  int dist_for_rect(cell* theCell, rect* theRect, coord_mode mode);
   bool check_overlap(rect cell, rect box);
-  bool check_overlap(cell* theCell, rect* theRect, std::string mode);
+  bool check_overlap(cell* theCell, rect* theRect, coord_mode mode);
   bool check_inside(rect cell, rect box);
-  bool check_inside(cell* theCell, rect* theRect, std::string mode);
+  bool check_inside(cell* theCell, rect* theRect, coord_mode mode);
   std::pair< bool, std::pair< int, int > > bin_search(int x_pos, cell* theCell, int x,
                                             int y);
-  std::pair< bool, pixel* > diamond_search(cell* theCell, int x, int y);
-  bool direct_move(cell* theCell, std::string mode);
+  std::pair< bool, std::pair< int, int > > diamond_search(cell* theCell, int x,
+                                                    int y);
+  std::pair< int, std::pair< int, int > > nearest_position(
+      cell* theCell, int x_coord, int y_coord, int site_begin = INT_MIN,
+      int site_end = INT_MAX, int max_dist = INT_MAX);
+  std::pair< int, std::pair< int, int > > window_position(
+      cell* theCell, int x_coord, int y_coord, int x_reach, int y_reach,
+      int bound, int site_begin = INT_MIN, int site_end = INT_MAX);
+  bool direct_move(cell* theCell, coord_mode mode);
   bool direct_move(cell* theCell, int x, int y);
   bool shift_move(cell* theCell, int x, int y);
-  bool shift_move(cell* theCell, std::string mode);
-  bool map_move(cell* theCell, std::string mode);
-  bool map_move(cell* theCell, int x, int y);
+  bool shift_move(cell* theCell, coord_mode mode);
+  bool map_move(cell* theCell, coord_mode mode,
+                move_journal* journal = NULL);
+  bool map_move(cell* theCell, int x, int y, move_journal* journal = NULL);
   std::vector< cell* > overlap_cells(cell* theCell);
   std::vector< cell* > get_cells_from_boundary(rect* theRect);
   double dist_benefit(cell* theCell, int x_coord, int y_coord);
   bool swap_cell(cell* cellA, cell* cellB);
-  bool refine_move(cell* theCell, std::string mode);
+  bool refine_move(cell* theCell, coord_mode mode);
   bool refine_move(cell* theCell, int x_coord, int y_coord);
-  pixel* get_pixel(int x_pos, int y_pos);
+  const pixel* get_pixel(int x_pos, int y_pos) const {
+    return grid.at(x_pos, y_pos);
+  }
+  pixel* edit_pixel(int x_pos, int y_pos) { return grid.edit(x_pos, y_pos); }
+  void share_blocked_tiles();
+  cell* pixel_cell(const pixel* thePixel);
   std::pair< bool, cell* > nearest_cell(int x_coord, int y_coord);
 
   // place.cpp - By SGD
   void simple_placement(CMeasure& measure);
   void non_group_cell_pre_placement();
   void group_cell_pre_placement();
-  void non_group_cell_placement(std::string mode);
-  void group_cell_placement(std::string mode);
-  void group_cell_placement(std::string mode, std::string mode2);
+  void non_group_cell_placement(coord_mode mode);
+  void parallel_non_group_cell_placement(coord_mode mode);
+  void group_cell_placement(coord_mode mode);
+  void group_cell_placement(coord_mode mode, std::string mode2);
+  void group_cell_placement(group* theGroup, coord_mode mode);
+  std::vector< group* > groups_by_size();
   void brick_placement_1(group* theGroup);
   void brick_placement_2(group* theGroup);
   int group_refine(group* theGroup);
-  int group_annealing(group* theGroup);
+  int group_annealing(group* theGroup, refine_stats& stats);
   int non_group_annealing();
   int non_group_refine();
 
@@ -632,8 +1192,54 @@ class circuit {
   void cell_y_align(cell* theCell);
   void group_pixel_assign();
   void group_pixel_assign_2();
-  void erase_pixel(cell* theCell);
-  bool paint_pixel(cell* theCell, int x_pos, int y_pos);
+  void erase_pixel(cell* theCell, move_journal* journal = NULL);
+  bool paint_pixel(cell* theCell, int x_pos, int y_pos,
+                   move_journal* journal = NULL);
+  void rollback(move_journal& journal);
+
+  // abacus.cpp
+  void abacus_group_cell_placement();
+  void abacus_non_group_cell_placement();
+  bool abacus_placement(free_site_map* theMap, std::vector< cell* >& cell_list,
+                        bool shift);
+
+  // reassign.cpp
+  unsigned long long footprint_class(cell* theCell);
+  int assignment_refine(std::vector< cell* >& cell_list,
+                        std::vector< int >& pass_moved);
+  int assignment_solve(std::vector< cell* >& cell_list);
+  int swap_refine(std::vector< cell* >& cell_list, refine_stats& stats);
+
+  // eco.cpp
+  void eco_placement(CMeasure& measure);
+  bool eco_hold(cell* theCell);
+
+  // netlist.cpp
+  void build_netlist();
+  void cell_coords(bool init_coord, std::vector< int >& x,
+                   std::vector< int >& y);
+  long long nets_hpwl(const int* x, const int* y, int first, int last);
+  long long total_hpwl(const std::vector< int >& x,
+                       const std::vector< int >& y);
+
+  // net_box.cpp
+  void init_net_boxes();
+  void clear_net_boxes();
+  net_box scan_net_box(unsigned net_id, const cell_move* moves,
+                       int num_moves);
+  net_box moved_net_box(unsigned net_id, const cell_move* moves,
+                        int num_moves, const moved_pin* net_pins,
+                        int num_pins);
+  void moved_pins(const cell_move* moves, int num_moves);
+  long long delta_hpwl(const cell_move* moves, int num_moves);
+  long long delta_hpwl(cell* theCell, int x_coord, int y_coord);
+  long long delta_hpwl(cell* cellA, cell* cellB);
+  void update_net_boxes(cell* theCell);
+
+  // free_sites.cpp
+  void init_free_sites();
+  free_site_map* cell_free_sites(cell* theCell);
+  void update_free_site(int x_pos, int y_pos);
 
   // check_legal.cpp - By SGD
   bool check_legality();
@@ -652,6 +1258,10 @@ bool read_line_as_tokens(std::istream& is, std::vector< std::string >& tokens);
 void get_next_token(std::ifstream& is, std::string& token, const char* beginComment);
 void get_next_n_tokens(std::ifstream& is, std::vector< std::string >& tokens, const unsigned n,
                        const char* beginComment);
+orient orient_from_str(const std::string& str);
+const char* orient_str(orient theOrient);
+macro_class macro_class_from_str(const std::string& str);
+const char* macro_class_str(macro_class theClass);
 
 inline int IntConvert(double fp) {
   return (int)(fp + 0.5f);
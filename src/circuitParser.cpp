@@ -1,5 +1,6 @@
 #include "circuitParser.h"
 #include <cfloat>
+#include <cstdarg>
 
 using opendp::circuit;
 using opendp::cell;
@@ -18,6 +19,7 @@ using opendp::macro_pin;
 using opendp::VDD;
 using opendp::VSS;
 using opendp::IntConvert;
+using opendp::name_view;
 
 
 using std::max;
@@ -230,7 +232,7 @@ CircuitParser::LefMacroCbk(
   }
 
   if( ma->hasClass() ) {
-    topMacro_->type = ma->macroClass();
+    topMacro_->type = opendp::macro_class_from_str(ma->macroClass());
   }
 
   if( ma->hasOrigin() ) {
@@ -326,6 +328,11 @@ CircuitParser::LefMacroPinCbk(
     }
   }
  
+  // index among the macro's pins, kept when a pin is defined again
+  OPENDP_HASH_MAP< string, macro_pin >::iterator it =
+    topMacro_->pins.find(pinName);
+  myPin.id = (it != topMacro_->pins.end())? 
+    it->second.id : topMacro_->pins.size();
   topMacro_->pins[pinName] = myPin;
 
   return 0; 
@@ -523,7 +530,7 @@ int CircuitParser::DefRowCbk(
   myRow->site = ckt->site2id.at( ro->macro() );
   myRow->origX = ro->x();
   myRow->origY = ro->y();
-  myRow->siteorient = ro->orientStr();
+  myRow->siteorient = static_cast<opendp::orient>(ro->orient());
 
 
   if( ro->hasDo() ){
@@ -560,241 +567,273 @@ int CircuitParser::DefPinCbk(
     defiUserData ud) {
   
   circuit* ckt = (circuit*) ud;
-  pin* myPin = ckt->locateOrCreatePin( pi->pinName() );
-  if( strcmp(pi->direction(), "INPUT") == 0 ) {
-    myPin -> type = PI_PIN;
-  }
-  else if( strcmp(pi->direction(), "OUTPUT") == 0 ) {
-    myPin -> type = PO_PIN;
-  }
-
-  myPin->isFixed = pi->isFixed();
-
-  // Shift by core.xLL and core.yLL
-  myPin->x_coord = pi->placementX() - ckt->core.xLL;
-  myPin->y_coord = pi->placementY() - ckt->core.yLL;
-
+  ckt->add_def_pin( pi->pinName(), 
+      pi->hasDirection()? pi->direction() : "", 
+      pi->isFixed(), pi->placementX(), pi->placementY() );
   return 0;
 }
 
-// DEF's COMPONENT parsing
-int CircuitParser::DefComponentCbk(
-    defrCallbackType_e c,
-    defiComponent* co, 
-    defiUserData ud) {
-
-  circuit* ckt = (circuit*) ud;
-  cell* myCell = NULL;
-  
-
-  // newly inserted cells
-  if( ckt->cell2id.find( co->id() ) == ckt->cell2id.end() ) {
-    myCell = ckt->locateOrCreateCell( co->id() );
-    myCell->type = ckt->macro2id[ co->name() ];
+void circuit::add_def_pin(
+    name_view name, name_view direction, bool fixed, int x, int y) {
+  pin* myPin = locateOrCreatePin( name );
+  if( direction == "INPUT" ) {
+    myPin -> type = PI_PIN;
   }
-  else {
-    myCell = ckt->locateOrCreateCell( co->id() );
+  else if( direction == "OUTPUT" ) {
+    myPin -> type = PO_PIN;
   }
-   
-//  cout << "co->id: " << co->id() << endl; 
-  macro* myMacro = &ckt->macros[ ckt->macro2id[ co->name() ]];
-  pair<double, double> orientSize 
-    = GetOrientSize( myMacro->width, myMacro->height, co->placementOrient());
 
-  myCell->width = orientSize.first * static_cast<double> (ckt->DEFdist2Microns);
-  myCell->height = orientSize.second * static_cast<double> (ckt->DEFdist2Microns);
+  myPin->isFixed = fixed;
 
-  myCell->isFixed = co->isFixed();
-  
   // Shift by core.xLL and core.yLL
-  myCell->init_x_coord = max(0.0, (co->placementX() - ckt->core.xLL)); 
-  myCell->init_y_coord = max(0.0, (co->placementY() - ckt->core.yLL));
-
-  // fixed cells
-  if( myCell->isFixed ) {
-    // Shift by core.xLL and core.yLL
-    myCell->x_coord = (co->placementX() - ckt->core.xLL);
-    myCell->y_coord = (co->placementY() - ckt->core.yLL);
-    myCell->isPlaced = true;
-  }
-  myCell->cellorient = co->placementOrientStr();
+  myPin->x_coord = x - core.xLL;
+  myPin->y_coord = y - core.yLL;
+}
 
-  return 0;
+// printf into the end of a string
+static void Appendf(string& text, const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(NULL, 0, format, args);
+  va_end(args);
+  size_t pos = text.size();
+  text.resize(pos + len + 1);
+  va_start(args, format);
+  vsnprintf(&text[pos], len + 1, format, args);
+  va_end(args);
+  text.resize(pos + len);
 }
 
-// DEF's COMPONENT parsing
-int CircuitParser::DefComponentWriteCbk(
-    defrCallbackType_e c,
-    defiComponent* co, 
-    defiUserData ud) {
+// the text of a component between its macro name and its placement
+static string DefComponentNets(defiComponent* co) {
+  string text;
+  for(int i = 0; i < co->numNets(); i++) Appendf(text, "%s ", co->net(i));
+  return text;
+}
 
-  circuit* ckt = (circuit*) ud;
-  // get FilePointer from ckt class
-  FILE* fout = ckt->fileOut;
-    
+// the text of a component after its placement
+static string DefComponentAttributes(defiComponent* co) {
+  string text;
   int i;
-  //  missing GENERATE, FOREIGN
-  fprintf(fout, "- %s %s ", co->id(), co->name());
-  //    co->changeIdAndName("idName", "modelName");
-  //    fprintf(fout, "%s %s ", co->id(),
-  //            co->name());
-  if(co->hasNets()) {
-    for(i = 0; i < co->numNets(); i++) fprintf(fout, "%s ", co->net(i));
-  }
-
-  // get Cell Object
-  cell* theCell = ckt->locateOrCreateCell(co->id());
-  int placeX = IntConvert(theCell->x_coord + ckt->core.xLL);
-  int placeY = IntConvert(theCell->y_coord + ckt->core.yLL);
-  string orientStr = theCell->cellorient;
-
-  if(co->isFixed())
-    fprintf(fout, "+ FIXED ( %d %d ) %s ", 
-        placeX, placeY, orientStr.c_str());
-  if(co->isCover())
-    fprintf(fout, "+ COVER ( %d %d ) %s ", 
-        placeX, placeY, orientStr.c_str());
-  if(co->isPlaced())
-    fprintf(fout, "+ PLACED ( %d %d ) %s ", 
-        placeX, placeY, orientStr.c_str());
-  if(co->isUnplaced()) {
-    fprintf(fout, "+ UNPLACED ");
-    if((placeX != -1) || (placeY != -1)) {
-      fprintf(fout, "( %d %d ) %s ", 
-        placeX, placeY, orientStr.c_str());
-    }
-  }
-  if(co->hasSource()) fprintf(fout, "+ SOURCE %s ", co->source());
+  if(co->hasSource()) Appendf(text, "+ SOURCE %s ", co->source());
   if(co->hasGenerate()) {
-    fprintf(fout, "+ GENERATE %s ", co->generateName());
+    Appendf(text, "+ GENERATE %s ", co->generateName());
     if(co->macroName() && *(co->macroName()))
-      fprintf(fout, "%s ", co->macroName());
+      Appendf(text, "%s ", co->macroName());
   }
-  if(co->hasWeight()) fprintf(fout, "+ WEIGHT %d ", co->weight());
-  if(co->hasEEQ()) fprintf(fout, "+ EEQMASTER %s ", co->EEQ());
-  if(co->hasRegionName()) fprintf(fout, "+ REGION %s ", co->regionName());
+  if(co->hasWeight()) Appendf(text, "+ WEIGHT %d ", co->weight());
+  if(co->hasEEQ()) Appendf(text, "+ EEQMASTER %s ", co->EEQ());
+  if(co->hasRegionName()) Appendf(text, "+ REGION %s ", co->regionName());
   if(co->hasRegionBounds()) {
     int *xl, *yl, *xh, *yh;
     int size;
     co->regionBounds(&size, &xl, &yl, &xh, &yh);
     for(i = 0; i < size; i++) {
-      fprintf(fout, "+ REGION %d %d %d %d \n", xl[i], yl[i], xh[i], yh[i]);
+      Appendf(text, "+ REGION %d %d %d %d \n", xl[i], yl[i], xh[i], yh[i]);
     }
   }
   if(co->maskShiftSize()) {
-    fprintf(fout, "+ MASKSHIFT ");
+    Appendf(text, "+ MASKSHIFT ");
 
     for(int i = co->maskShiftSize() - 1; i >= 0; i--) {
-      fprintf(fout, "%d", co->maskShift(i));
+      Appendf(text, "%d", co->maskShift(i));
     }
-    fprintf(fout, "\n");
+    Appendf(text, "\n");
   }
   if(co->hasHalo()) {
     int left, bottom, right, top;
     (void)co->haloEdges(&left, &bottom, &right, &top);
-    fprintf(fout, "+ HALO ");
-    if(co->hasHaloSoft()) fprintf(fout, "SOFT ");
-    fprintf(fout, "%d %d %d %d\n", left, bottom, right, top);
+    Appendf(text, "+ HALO ");
+    if(co->hasHaloSoft()) Appendf(text, "SOFT ");
+    Appendf(text, "%d %d %d %d\n", left, bottom, right, top);
   }
   if(co->hasRouteHalo()) {
-    fprintf(fout, "+ ROUTEHALO %d %s %s\n", co->haloDist(), co->minLayer(),
+    Appendf(text, "+ ROUTEHALO %d %s %s\n", co->haloDist(), co->minLayer(),
         co->maxLayer());
   }
   if(co->hasForeignName()) {
-    fprintf(fout, "+ FOREIGN %s %d %d %s %d ", co->foreignName(),
+    Appendf(text, "+ FOREIGN %s %d %d %s %d ", co->foreignName(),
         co->foreignX(), co->foreignY(), co->foreignOri(),
         co->foreignOrient());
   }
   if(co->numProps()) {
     for(i = 0; i < co->numProps(); i++) {
-      fprintf(fout, "+ PROPERTY %s %s ", co->propName(i), co->propValue(i));
+      Appendf(text, "+ PROPERTY %s %s ", co->propName(i), co->propValue(i));
       switch(co->propType(i)) {
         case 'R':
-          fprintf(fout, "REAL ");
+          Appendf(text, "REAL ");
           break;
         case 'I':
-          fprintf(fout, "INTEGER ");
+          Appendf(text, "INTEGER ");
           break;
         case 'S':
-          fprintf(fout, "STRING ");
+          Appendf(text, "STRING ");
           break;
         case 'Q':
-          fprintf(fout, "QUOTESTRING ");
+          Appendf(text, "QUOTESTRING ");
           break;
         case 'N':
-          fprintf(fout, "NUMBER ");
+          Appendf(text, "NUMBER ");
           break;
       }
     }
   }
-  fprintf(fout, ";\n");
+  return text;
+}
+
+// DEF's COMPONENT parsing
+int CircuitParser::DefComponentCbk(
+    defrCallbackType_e c,
+    defiComponent* co, 
+    defiUserData ud) {
 
+  circuit* ckt = (circuit*) ud;
+  ckt->add_def_component( co->id(), co->name(), co->placementStatus(), 
+      co->placementX(), co->placementY(), co->placementOrient(), 
+      DefComponentNets(co), DefComponentAttributes(co) );
   return 0;
 }
 
+void circuit::add_def_component(
+    name_view id, name_view macro_name, int status, 
+    int x, int y, int orient, 
+    const string& nets, const string& attributes) {
+  cell* myCell = NULL;
+
+  // newly inserted cells
+  if( cell2id.find( id ) == cell2id.end() ) {
+    myCell = locateOrCreateCell( id );
+    myCell->type = macro2id[ macro_name ];
+  }
+  else {
+    myCell = locateOrCreateCell( id );
+  }
+   
+  macro* myMacro = &macros[ macro2id[ macro_name ]];
+  pair<double, double> orientSize 
+    = GetOrientSize( myMacro->width, myMacro->height, orient);
+
+  myCell->width = orientSize.first * static_cast<double> (DEFdist2Microns);
+  myCell->height = orientSize.second * static_cast<double> (DEFdist2Microns);
+
+  myCell->isFixed = (status == DEFI_COMPONENT_FIXED);
+  
+  // Shift by core.xLL and core.yLL
+  myCell->init_x_coord = max(0.0, (x - core.xLL)); 
+  myCell->init_y_coord = max(0.0, (y - core.yLL));
+
+  // fixed cells
+  if( myCell->isFixed ) {
+    // Shift by core.xLL and core.yLL
+    myCell->x_coord = (x - core.xLL);
+    myCell->y_coord = (y - core.yLL);
+    myCell->isPlaced = true;
+  }
+  myCell->cellorient = static_cast<opendp::orient>(orient);
+
+  // everything but the placement is written back as it was read
+  opendp::def_component comp;
+  comp.cell = myCell->id;
+  comp.status = status;
+  comp.nets = comp.attributes = UINT_MAX;
+  if( nets != "" ) {
+    comp.nets = def_component_texts.size();
+    def_component_texts.push_back(nets);
+  }
+  if( attributes != "" ) {
+    comp.attributes = def_component_texts.size();
+    def_component_texts.push_back(attributes);
+  }
+  def_components.push_back(comp);
+}
+
+// previous legal DEF's COMPONENT parsing ( -eco_def ), only the placed
+// cells that kept their macro are recorded
+int CircuitParser::DefComponentEcoCbk(
+    defrCallbackType_e c,
+    defiComponent* co, 
+    defiUserData ud) {
+
+  circuit* ckt = (circuit*) ud;
+  if( !co->isPlaced() && !co->isFixed() ) {
+    return 0;
+  }
+  auto cellPtr = ckt->cell2id.find( co->id() );
+  auto macroPtr = ckt->macro2id.find( co->name() );
+  if( cellPtr == ckt->cell2id.end() || macroPtr == ckt->macro2id.end() ) {
+    return 0;
+  }
+  cell* myCell = &ckt->cells[ cellPtr->second ];
+  if( myCell->type != macroPtr->second ) {
+    return 0;
+  }
+  ckt->eco_coords[ cellPtr->second ] 
+    = make_pair( max(0.0, (co->placementX() - ckt->core.xLL)), 
+                 max(0.0, (co->placementY() - ckt->core.yLL)) );
+  return 0;
+}
+
+// DEF's COMPONENT parsing
 // DEF's NET
 int CircuitParser::DefNetCbk(
     defrCallbackType_e c,
     defiNet* dnet, 
     defiUserData ud) {
   circuit* ckt = (circuit*) ud;
-  net* myNet = NULL;
-
-  myNet = ckt->locateOrCreateNet( dnet->name() );
-  unsigned myNetId = ckt->net2id.find(myNet->name)->second;
+  unsigned myNetId = ckt->add_def_net( dnet->name() );
 
   // subNet iterations
   for(int i=0; i<dnet->numConnections(); i++) {
-    // Extract pin informations
-    string pinName = (strcmp(dnet->instance(i), "PIN") == 0)? 
-      dnet->pin(i) : 
-      string(dnet->instance(i)) + ":" + string(dnet->pin(i));
+    ckt->add_def_net_pin( myNetId, dnet->instance(i), dnet->pin(i), i == 0 );
+  }
+  return 0;
+}
 
-    pin* myPin = ckt->locateOrCreatePin( pinName );
-    myPin->net = myNetId;
+unsigned circuit::add_def_net(name_view name) {
+  return locateOrCreateNet( name ) - &nets[0];
+}
 
-    // source setting
-    if( i == 0 ) {
-      myNet->source = myPin->id; 
-    }
+// the first pin of a net is its source, the rest are sinks
+void circuit::add_def_net_pin(
+    unsigned net_id, name_view instance, name_view pin_name, bool source) {
+  pin* myPin = NULL;
 
-    // if it is cell inst's pin (e.g. not equal to "PIN")
-    // Fill owner's info
-    if( strcmp(dnet->instance(i), "PIN") != 0 ) {
-      myPin->owner = ckt->cell2id[ dnet->instance(i) ];
-      myPin->type = NONPIO_PIN;
-
-//      cout << "owner's name: " << dnet->instance(i) << endl;
-//      cout << "owner: " << myPin->owner << endl;
-//      cout << "type: " << ckt->cells[myPin->owner].type << endl; 
-      macro* theMacro = &ckt->macros[ ckt->cells[myPin->owner].type ];
-//      cout << "theMacro: " << theMacro << endl;
-//      cout << "theMacro pin size: " << theMacro->pins.size() << endl;
-//      cout << "dnet->pin: " << dnet->pin(i) << endl;
-      macro_pin* myMacroPin = &theMacro->pins[ dnet->pin(i) ];
-//      cout << "myMacroPin: " << myMacroPin << endl;
-//      cout << "port: " << myMacroPin->port.size() << endl;
-
-      if( myMacroPin-> port.size() == 0 ) {
-        cout << "ERROR: in Net " << dnet->name() 
-          << " has a module:pin definition as " << pinName 
-          << " but there is no PORT/PIN definition in LEF MACRO: " 
-          << theMacro->name << endl;
-        exit(1);
-      }
-      myPin->x_offset = 
-        myMacroPin->port[0].xLL / 2 + myMacroPin->port[0].xUR / 2;
-      myPin->y_offset = 
-        myMacroPin->port[0].yLL / 2 + myMacroPin->port[0].yUR / 2;
-//      cout << "calculated x_offset: " << myPin->x_offset << endl;
-//      cout << "calculated y_offset: " << myPin->y_offset << endl;
+  // IO pins go by name, instance pins by ( owner, macro pin )
+  if( instance == "PIN" ) {
+    myPin = locateOrCreatePin( pin_name );
+    myPin->net = net_id;
+  }
+  else {
+    unsigned owner = cell2id[ instance ];
+    macro* theMacro = &macros[ cells[owner].type ];
+    macro_pin* myMacroPin = &theMacro->pins[ pin_name.str() ];
+
+    if( myMacroPin-> port.size() == 0 ) {
+      cout << "ERROR: in Net " << nets[net_id].name 
+        << " has a module:pin definition as " << instance 
+        << ":" << pin_name 
+        << " but there is no PORT/PIN definition in LEF MACRO: " 
+        << theMacro->name << endl;
+      exit(1);
     }
 
-    if( i != 0 ){
-      myNet->sinks.push_back(myPin->id);
-    }
+    myPin = locateOrCreatePin( owner, myMacroPin->id );
+    myPin->net = net_id;
+    myPin->owner = owner;
+    myPin->type = NONPIO_PIN;
+    myPin->x_offset = 
+      myMacroPin->port[0].xLL / 2 + myMacroPin->port[0].xUR / 2;
+    myPin->y_offset = 
+      myMacroPin->port[0].yLL / 2 + myMacroPin->port[0].yUR / 2;
+  }
+
+  net* myNet = &nets[net_id];
+  if( source ) {
+    myNet->source = myPin->id; 
+  }
+  else {
+    myNet->sinks.push_back(myPin->id);
   }
-  return 0;
 }
 
 // DEF's SPECIALNETS
@@ -876,7 +915,22 @@ int CircuitParser::DefRegionCbk(
     defiUserData ud) {
 
   circuit* ckt = (circuit*) ud;
-  group* curGroup = ckt->locateOrCreateGroup(re->name());
+  vector<opendp::rect> rects;
+  for(int i = 0; i < re->numRectangles(); i++) {
+    opendp::rect tmpRect;
+    tmpRect.xLL = re->xl(i);
+    tmpRect.yLL = re->yl(i);
+    tmpRect.xUR = re->xh(i);
+    tmpRect.yUR = re->yh(i); 
+    rects.push_back( tmpRect );
+  }
+  ckt->add_def_region( re->name(), rects, re->type() );
+  return 0;
+}
+
+void circuit::add_def_region(
+    name_view name, const vector<rect>& rects, name_view type) {
+  group* curGroup = locateOrCreateGroup( name.str() );
 
   // initialize for BB
   curGroup->boundary.xLL = DBL_MAX;
@@ -884,12 +938,8 @@ int CircuitParser::DefRegionCbk(
   curGroup->boundary.xUR = DBL_MIN;
   curGroup->boundary.yUR = DBL_MIN;
 
-  for(int i = 0; i < re->numRectangles(); i++) {
-    opendp::rect tmpRect;
-    tmpRect.xLL = re->xl(i);
-    tmpRect.yLL = re->yl(i);
-    tmpRect.xUR = re->xh(i);
-    tmpRect.yUR = re->yh(i); 
+  for(size_t i = 0; i < rects.size(); i++) {
+    const rect& tmpRect = rects[i];
     
     // Extract BB
     curGroup->boundary.xLL = min(curGroup->boundary.xLL, tmpRect.xLL);
@@ -900,8 +950,7 @@ int CircuitParser::DefRegionCbk(
     // push rect info
     curGroup->regions.push_back( tmpRect );
   }
-  curGroup->type = re->type();
-  return 0;
+  curGroup->type = type.str();
 }
 
 // DEF's GROUPS -> call groups
@@ -919,21 +968,24 @@ int CircuitParser::DefGroupMemberCbk(
     const char* name,
     defiUserData ud) {
   circuit* ckt = (circuit*) ud;
+  ckt->add_def_group_member( topGroup_, name );
+  return 0;
+}
 
-  topGroup_->tag = name;
-  for(auto& curCell : ckt->cells) {
+void circuit::add_def_group_member(group* theGroup, name_view member) {
+  theGroup->tag = member.str();
+  unsigned groupId = group2id[theGroup->name];
+  for(auto& curCell : cells) {
     // HARD CODE
     // Suppose tag is always SOMETH/*
     // need to port regexp lib later
-    if(strncmp(topGroup_->tag.c_str(), curCell.name.c_str(),
-          topGroup_->tag.size() - 1) == 0) {
-      topGroup_->siblings.push_back(&curCell);
-      curCell.group = topGroup_->name;
+    if(strncmp(theGroup->tag.c_str(), cell_name(&curCell).c_str(),
+          theGroup->tag.size() - 1) == 0) {
+      theGroup->siblings.push_back(&curCell);
+      curCell.group = groupId;
       curCell.inGroup = true;
     }
   } 
-
-  return 0;
 }
 
 // Y first and X second
@@ -961,7 +1013,7 @@ vector<opendp::row> GetNewRow(const circuit* ckt) {
   int rowCntY = IntConvert((ckt->core.yUR - ckt->core.yLL)/ckt->rowHeight);
 
   unsigned siteIdx = ckt->prevrows[0].site;
-  string curOrient = ckt->prevrows[0].siteorient;
+  opendp::orient curOrient = ckt->prevrows[0].siteorient;
 
   for(int i=0; i<rowCntY; i++) {
     opendp::row myRow;
@@ -977,7 +1029,7 @@ vector<opendp::row> GetNewRow(const circuit* ckt) {
     retRow.push_back(myRow);
 
     // curOrient is flipping. e.g. N -> FS -> N -> FS -> ...
-    curOrient = (curOrient == "N")? "FS" : "N";
+    curOrient = (curOrient == opendp::ORIENT_N)? opendp::ORIENT_FS : opendp::ORIENT_N;
   }
   return retRow;
 }
@@ -51,8 +51,9 @@ public:
   static int DefGroupMemberCbk(defrCallbackType_e c, const char* name, defiUserData ud);
 
 
+  static int DefComponentEcoCbk(defrCallbackType_e c, defiComponent* co, defiUserData ud);
+
   // DEF writing function
-  static int DefComponentWriteCbk(defrCallbackType_e c, defiComponent* co, defiUserData ud);
 
 };
 
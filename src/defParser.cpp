@@ -2730,7 +2730,9 @@ int unUsedCB(defrCallbackType_e, void*, defiUserData) {
 
 static void printWarning(const char* str) { fprintf(stderr, "%s\n", str); }
 
-int circuit::ReadDef(const string& defName) {
+// read_func, if given, feeds the Si2 parser instead of reading defName
+int circuit::ReadDef(const string& defName,
+                     size_t (*read_func)(FILE*, char*, size_t)) {
   FILE* f = NULL;
   //  long start_mem;
   int line_num_print_interval = 10000;
@@ -2946,7 +2948,9 @@ int circuit::ReadDef(const string& defName) {
     exit(1);
   }     
 
+  if(read_func) defrSetReadFunction(read_func);
   int res = defrRead(f, fileStr, userData, 1);
+  if(read_func) defrUnsetReadFunction();
   if( res ) {
     cout << "Reader returns bad status: " << fileStr << endl;
     exit(1); 
@@ -3097,18 +3101,52 @@ int circuit::ReadDef(const string& defName) {
 }
 
 
-// takes inputDef, and writeOut in ckt->fileOut pointer
-void circuit::WriteDefComponents(const string& defName) {
+// writes the COMPONENTS recorded by ReadDef into fileOut, at the cells'
+// current placement
+void circuit::WriteDefComponents() {
+  for(size_t i = 0; i < def_components.size(); i++) {
+    const def_component& comp = def_components[i];
+    const cell* theCell = &cells[comp.cell];
+    fprintf(fileOut, "- %s %s ", cell_name(theCell).c_str(),
+        macros[theCell->type].name.c_str());
+    if(comp.nets != UINT_MAX)
+      fputs(def_component_texts[comp.nets].c_str(), fileOut);
+
+    int placeX = IntConvert(theCell->x_coord + core.xLL);
+    int placeY = IntConvert(theCell->y_coord + core.yLL);
+    const char* orientStr = orient_str(theCell->cellorient);
+    switch(comp.status) {
+      case DEFI_COMPONENT_FIXED:
+        fprintf(fileOut, "+ FIXED ( %d %d ) %s ", placeX, placeY, orientStr);
+        break;
+      case DEFI_COMPONENT_COVER:
+        fprintf(fileOut, "+ COVER ( %d %d ) %s ", placeX, placeY, orientStr);
+        break;
+      case DEFI_COMPONENT_PLACED:
+        fprintf(fileOut, "+ PLACED ( %d %d ) %s ", placeX, placeY, orientStr);
+        break;
+      case DEFI_COMPONENT_UNPLACED:
+        fprintf(fileOut, "+ UNPLACED ");
+        if((placeX != -1) || (placeY != -1)) {
+          fprintf(fileOut, "( %d %d ) %s ", placeX, placeY, orientStr);
+        }
+        break;
+    }
+
+    if(comp.attributes != UINT_MAX)
+      fputs(def_component_texts[comp.attributes].c_str(), fileOut);
+    fprintf(fileOut, ";\n");
+  }
+}
+
+// reads the COMPONENTS of a previous legal DEF into eco_coords
+void circuit::ReadEcoDef(const string& defName) {
   FILE* f = NULL;
-  //  long start_mem;
-  int line_num_print_interval = 10000;
 
-  //  start_mem = (long)sbrk(0);
   fout = stdout;
   CircuitParser cp(this);
   userData = cp.Circuit();
-
-//  defrSetLogFunction(myLogFunction);
+  eco_coords.assign(cells.size(), make_pair(-1.0, -1.0));
 
   defrInitSession(0);
   defrSetUserData(userData);
@@ -3117,13 +3155,13 @@ void circuit::WriteDefComponents(const string& defName) {
   // 
   // CircuitCallBack 
   //
-  defrSetComponentCbk(cp.DefComponentWriteCbk);
+  defrSetComponentCbk(cp.DefComponentEcoCbk);
   
 
   ////// File Read 
   char* fileStr = strdup(defName.c_str());
   if((f = fopen(fileStr, "r")) == 0) {
-    fprintf(stderr, "**\nERROR: Couldn't open output file '%s'\n",
+    fprintf(stderr, "**\nERROR: Couldn't open eco input file '%s'\n",
             fileStr);
     exit(1);
   }     
@@ -3137,9 +3175,6 @@ void circuit::WriteDefComponents(const string& defName) {
     cout << "Reading " << fileStr << " is Done" << endl;  
   } 
 
-
-  //// defrUnset all Cbk functions
-//  (void)defrPrintUnusedCallbacks(fout);
   (void)defrReleaseNResetMemory();
 
   (void)defrUnsetCallbacks();
@@ -3148,6 +3183,7 @@ void circuit::WriteDefComponents(const string& defName) {
   defrUnsetComponentCbk();
 
   fclose(f);
+  free(fileStr);
 
   // Release allocated singleton data.
   defrClear();
@@ -0,0 +1,499 @@
+/////////////////////////////////////////////////////////////////////////////
+// Authors: SangGi Do(sanggido@unist.ac.kr), Mingyu Woo(mwoo@eng.ucsd.edu)
+//          (respective Ph.D. advisors: Seokhyeong Kang, Andrew B. Kahng)
+//
+//          Original parsing structure was made by Myung-Chul Kim (IBM).
+//
+// BSD 3-Clause License
+//
+// Copyright (c) 2018, SangGi Do and Mingyu Woo
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "circuit.h"
+#include "defrReader.hpp"
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using opendp::circuit;
+using opendp::group;
+using opendp::rect;
+using opendp::name_view;
+
+using std::cout;
+using std::endl;
+using std::vector;
+using std::pair;
+using std::make_pair;
+using std::string;
+
+// DEF reader over a memory mapped file. COMPONENTS, PINS, NETS, REGIONS and
+// GROUPS are tokenized in place and handed to the same circuit::add_def_*
+// functions as the Si2 callbacks; the rest of the file goes through the Si2
+// parser, fed from the mapping. The sections are checked before anything is
+// added, so a construct the native path does not know sends the whole file
+// to ReadDef instead.
+
+namespace {
+
+enum def_section_kind {
+  SECTION_COMPONENTS,
+  SECTION_PINS,
+  SECTION_NETS,
+  SECTION_REGIONS,
+  SECTION_GROUPS,
+  NUM_SECTIONS
+};
+
+const char* section_names[NUM_SECTIONS] = {"COMPONENTS", "PINS", "NETS",
+                                           "REGIONS", "GROUPS"};
+
+// a section of the mapped file, from the start of its first line to the end
+// of its END line
+struct def_section {
+  def_section_kind kind;
+  const char* begin;
+  const char* end;
+};
+
+// the tokens of the Si2 lexer without copies. Tokens are separated by
+// blanks ( Si2 drops '\r' ) and one starting with '#' comments out the rest
+// of the line. At the end of the text, next() gives an empty token
+struct def_lexer {
+  const char* pos;
+  const char* end;
+
+  def_lexer(const char* first, const char* last) : pos(first), end(last) {}
+  name_view next();
+};
+
+inline bool is_blank(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+name_view def_lexer::next() {
+  for(;;) {
+    while(pos < end && is_blank(*pos)) pos++;
+    if(pos == end || *pos != '#') break;
+    while(pos < end && *pos != '\n') pos++;
+  }
+  const char* first = pos;
+  while(pos < end && !is_blank(*pos)) pos++;
+  return name_view(first, pos - first);
+}
+
+// values outside of int are left to the DEF parser
+bool to_int(name_view token, int* value) {
+  unsigned i = (token.size > 0 && token.data[0] == '-') ? 1 : 0;
+  if(i == token.size || token.size - i > 10) return false;
+  long long result = 0;
+  for(; i < token.size; i++) {
+    if(token.data[i] < '0' || token.data[i] > '9') return false;
+    result = 10 * result + (token.data[i] - '0');
+  }
+  if(token.data[0] == '-') result = -result;
+  if(result < INT_MIN || result > INT_MAX) return false;
+  *value = result;
+  return true;
+}
+
+// ( x y ) orient, orient as the DEF parser's index
+bool read_placement(def_lexer& lex, int* x, int* y, int* orient) {
+  if(!(lex.next() == "(") || !to_int(lex.next(), x) ||
+     !to_int(lex.next(), y) || !(lex.next() == ")"))
+    return false;
+  name_view token = lex.next();
+  for(int i = 0; i < 8; i++) {
+    if(token == opendp::orient_str(static_cast< opendp::orient >(i))) {
+      *orient = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool read_point(def_lexer& lex, int* x, int* y) {
+  return lex.next() == "(" && to_int(lex.next(), x) && to_int(lex.next(), y) &&
+         lex.next() == ")";
+}
+
+// names the native path leaves to Si2: quoted strings, &alias uses,
+// the empty token at the end of the text
+bool plain_name(name_view token) {
+  return token.size > 0 && token.data[0] != '"' && token.data[0] != '&';
+}
+
+// the + clauses of NETS and GROUPS statements that no callback reads, and
+// the + keywords inside routing
+const char* net_clauses[] = {
+    "USE",     "SOURCE",    "WEIGHT", "PATTERN", "ROUTED",    "FIXED",
+    "COVER",   "NOSHIELD",  "ESTCAP", "XTALK",   "FREQUENCY", "ORIGINAL",
+    "SUBNET",  "SHIELDNET", "VPIN",   "SHAPE",   "MASK",      "RECT",
+    "VIRTUAL", "NONDEFAULTRULE", NULL};
+const char* group_clauses[] = {"REGION", "SOFT", NULL};
+
+// skips the + clauses of a statement up to its ';'. Each has to start with
+// one of clauses
+bool skip_clauses(def_lexer& lex, name_view token, const char** clauses) {
+  while(!(token == ";")) {
+    if(!plain_name(token)) return false;
+    if(token == "+") {
+      token = lex.next();
+      int i = 0;
+      while(clauses[i] && !(token == clauses[i])) i++;
+      if(!clauses[i]) return false;
+    }
+    token = lex.next();
+  }
+  return true;
+}
+
+// - id macro + PLACED|FIXED|COVER ( x y ) orient [ + SOURCE s ]
+//   [ + WEIGHT w ] ;
+bool read_component(def_lexer& lex, circuit* ckt) {
+  name_view id = lex.next();
+  name_view macro_name = lex.next();
+  if(!plain_name(id) || !plain_name(macro_name)) return false;
+
+  int status = 0, x = 0, y = 0, orient = 0;
+  name_view source;
+  int weight = -1;
+  name_view token;
+  for(token = lex.next(); token == "+"; token = lex.next()) {
+    token = lex.next();
+    if(token == "PLACED" || token == "FIXED" || token == "COVER") {
+      if(status != 0) return false;
+      status = (token == "PLACED")
+                   ? DEFI_COMPONENT_PLACED
+                   : (token == "FIXED") ? DEFI_COMPONENT_FIXED
+                                        : DEFI_COMPONENT_COVER;
+      if(!read_placement(lex, &x, &y, &orient)) return false;
+    }
+    else if(token == "SOURCE") {
+      source = lex.next();
+      if(!plain_name(source)) return false;
+    }
+    else if(token == "WEIGHT") {
+      if(!to_int(lex.next(), &weight) || weight < 0) return false;
+    }
+    else
+      return false;
+  }
+  if(!(token == ";") || status == 0) return false;
+  if(!ckt) return true;
+
+  // in the order of DefComponentAttributes
+  string attributes;
+  if(source.data) attributes += "+ SOURCE " + source.str() + " ";
+  if(weight >= 0) attributes += "+ WEIGHT " + std::to_string(weight) + " ";
+  ckt->add_def_component(id, macro_name, status, x, y, orient, string(),
+                         attributes);
+  return true;
+}
+
+// - name + NET n [ + SPECIAL ] + DIRECTION d [ + USE u ]
+//   [ + LAYER l ( x y ) ( x y ) ] [ + PLACED|FIXED|COVER ( x y ) orient ] ;
+bool read_pin(def_lexer& lex, circuit* ckt) {
+  name_view name = lex.next();
+  if(!plain_name(name)) return false;
+
+  name_view direction;
+  bool fixed = false, placed = false;
+  int x = 0, y = 0, orient = 0, layer_x = 0, layer_y = 0;
+  name_view token;
+  for(token = lex.next(); token == "+"; token = lex.next()) {
+    token = lex.next();
+    if(token == "NET" || token == "USE") {
+      if(!plain_name(lex.next())) return false;
+    }
+    else if(token == "DIRECTION") {
+      direction = lex.next();
+      if(!plain_name(direction)) return false;
+    }
+    else if(token == "LAYER") {
+      if(!plain_name(lex.next()) || !read_point(lex, &layer_x, &layer_y) ||
+         !read_point(lex, &layer_x, &layer_y))
+        return false;
+    }
+    else if(token == "PLACED" || token == "FIXED" || token == "COVER") {
+      if(placed) return false;
+      placed = true;
+      fixed = (token == "FIXED");
+      if(!read_placement(lex, &x, &y, &orient)) return false;
+    }
+    else if(!(token == "SPECIAL"))
+      return false;
+  }
+  if(!(token == ";") || !direction.data) return false;
+  if(ckt) ckt->add_def_pin(name, direction, fixed, x, y);
+  return true;
+}
+
+// - name ( instance pin ) ... [ + clauses ] ;
+bool read_net(def_lexer& lex, circuit* ckt) {
+  name_view name = lex.next();
+  if(!plain_name(name) || name == "MUSTJOIN") return false;
+
+  unsigned net_id = ckt ? ckt->add_def_net(name) : 0;
+  bool source = true;
+  name_view token;
+  for(token = lex.next(); token == "("; token = lex.next()) {
+    name_view instance = lex.next();
+    name_view pin_name = lex.next();
+    if(!plain_name(instance) || !plain_name(pin_name) || instance == "*" ||
+       !(lex.next() == ")"))
+      return false;
+    if(ckt) ckt->add_def_net_pin(net_id, instance, pin_name, source);
+    source = false;
+  }
+  return skip_clauses(lex, token, net_clauses);
+}
+
+// - name ( x y ) ( x y ) ... + TYPE FENCE|GUIDE ;
+bool read_region(def_lexer& lex, circuit* ckt) {
+  name_view name = lex.next();
+  if(!plain_name(name)) return false;
+
+  vector< rect > rects;
+  name_view token;
+  for(token = lex.next(); token == "("; token = lex.next()) {
+    int xl, yl, xh, yh;
+    if(!to_int(lex.next(), &xl) || !to_int(lex.next(), &yl) ||
+       !(lex.next() == ")") || !read_point(lex, &xh, &yh))
+      return false;
+    rect theRect;
+    theRect.xLL = xl;
+    theRect.yLL = yl;
+    theRect.xUR = xh;
+    theRect.yUR = yh;
+    rects.push_back(theRect);
+  }
+  if(!(token == "+") || !(lex.next() == "TYPE")) return false;
+  name_view type = lex.next();
+  if(!(type == "FENCE") && !(type == "GUIDE")) return false;
+  if(!(lex.next() == ";")) return false;
+  if(ckt) ckt->add_def_region(name, rects, type);
+  return true;
+}
+
+// - name member ... [ + clauses ] ;
+bool read_group(def_lexer& lex, circuit* ckt) {
+  name_view name = lex.next();
+  if(!plain_name(name)) return false;
+
+  group* theGroup = ckt ? ckt->locateOrCreateGroup(name.str()) : NULL;
+  name_view token;
+  for(token = lex.next(); !(token == "+") && !(token == ";");
+      token = lex.next()) {
+    if(!plain_name(token)) return false;
+    if(ckt) ckt->add_def_group_member(theGroup, token);
+  }
+  return skip_clauses(lex, token, group_clauses);
+}
+
+// reads a section from its first line. Without ckt the section is only
+// checked. Returns the end of its END line, NULL if the native path cannot
+// read the section
+const char* read_section(def_section_kind kind, const char* begin,
+                         const char* end, circuit* ckt) {
+  def_lexer lex(begin, end);
+  int count = 0;
+  if(!(lex.next() == section_names[kind]) || !to_int(lex.next(), &count) ||
+     !(lex.next() == ";"))
+    return NULL;
+
+  if(ckt) {
+    // as DefStartCbk
+    if(kind == SECTION_COMPONENTS) ckt->cells.reserve(count);
+    if(kind == SECTION_PINS) ckt->pins.reserve(count);
+    if(kind == SECTION_NETS) ckt->nets.reserve(count);
+  }
+
+  bool (*read_statement)(def_lexer&, circuit*) = NULL;
+  switch(kind) {
+    case SECTION_COMPONENTS:
+      read_statement = read_component;
+      break;
+    case SECTION_PINS:
+      read_statement = read_pin;
+      break;
+    case SECTION_NETS:
+      read_statement = read_net;
+      break;
+    case SECTION_REGIONS:
+      read_statement = read_region;
+      break;
+    default:
+      read_statement = read_group;
+      break;
+  }
+
+  name_view token;
+  for(token = lex.next(); token == "-"; token = lex.next())
+    if(!read_statement(lex, ckt)) return NULL;
+  if(!(token == "END") || !(lex.next() == section_names[kind])) return NULL;
+
+  // nothing else on the END line
+  for(; lex.pos < end && *lex.pos != '\n'; lex.pos++)
+    if(!is_blank(*lex.pos)) return NULL;
+  return (lex.pos < end) ? lex.pos + 1 : end;
+}
+
+// whether the line starts with keyword
+bool line_starts_with(const char* line, const char* end, const char* keyword) {
+  while(line < end && (*line == ' ' || *line == '\t')) line++;
+  size_t len = strlen(keyword);
+  return end - line > (ptrdiff_t)len && memcmp(line, keyword, len) == 0 &&
+         is_blank(line[len]);
+}
+
+// the section whose first line starts at line, NUM_SECTIONS if none
+def_section_kind section_at(const char* line, const char* end) {
+  for(int i = 0; i < NUM_SECTIONS; i++)
+    if(line_starts_with(line, end, section_names[i]))
+      return static_cast< def_section_kind >(i);
+  return NUM_SECTIONS;
+}
+
+// the text between the native sections, read by the Si2 parser through
+// read_si2_text
+vector< pair< const char*, const char* > > si2_text;
+size_t si2_part = 0;
+const char* si2_pos = NULL;
+
+size_t read_si2_text(FILE*, char* buffer, size_t size) {
+  size_t num_read = 0;
+  while(num_read < size && si2_part < si2_text.size()) {
+    size_t len = std::min(size - num_read,
+                          (size_t)(si2_text[si2_part].second - si2_pos));
+    memcpy(buffer + num_read, si2_pos, len);
+    num_read += len;
+    si2_pos += len;
+    if(si2_pos == si2_text[si2_part].second && ++si2_part < si2_text.size())
+      si2_pos = si2_text[si2_part].first;
+  }
+  return num_read;
+}
+
+}  // namespace
+
+int circuit::read_def_mmap(const string& defName) {
+#ifdef WIN32
+  return ReadDef(defName);
+#else
+  double start = omp_get_wtime();
+  int fd = open(defName.c_str(), O_RDONLY);
+  struct stat st;
+  if(fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+    if(fd >= 0) close(fd);
+    cout << "read_def_mmap:: cannot map " << defName << ", reading with Si2"
+         << endl;
+    return ReadDef(defName);
+  }
+  size_t size = st.st_size;
+  void* mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(mapped == MAP_FAILED) {
+    cout << "read_def_mmap:: cannot map " << defName << ", reading with Si2"
+         << endl;
+    return ReadDef(defName);
+  }
+  const char* begin = static_cast< const char* >(mapped);
+  const char* end = begin + size;
+  madvise(mapped, size, MADV_SEQUENTIAL);
+
+  // find and check the native sections. The Si2 part after the first one
+  // must not define what they depend on ( UNITS, ROW ), and names have to
+  // be case sensitive
+  vector< def_section > sections;
+  const char* unusual = NULL;
+  for(const char* line = begin; line < end && !unusual;) {
+    def_section_kind kind = section_at(line, end);
+    if(kind != NUM_SECTIONS) {
+      def_section section;
+      section.kind = kind;
+      section.begin = line;
+      section.end = read_section(kind, line, end, NULL);
+      if(!section.end) {
+        unusual = section_names[kind];
+        break;
+      }
+      sections.push_back(section);
+      line = section.end;
+      continue;
+    }
+    if(line_starts_with(line, end, "NAMESCASESENSITIVE"))
+      unusual = "NAMESCASESENSITIVE";
+    else if(!sections.empty() && (line_starts_with(line, end, "UNITS") ||
+                                  line_starts_with(line, end, "ROW")))
+      unusual = "UNITS or ROW after the placement sections";
+    const char* next =
+        static_cast< const char* >(memchr(line, '\n', end - line));
+    line = next ? next + 1 : end;
+  }
+  if(unusual) {
+    munmap(mapped, size);
+    cout << "read_def_mmap:: unsupported " << unusual << " in " << defName
+         << ", reading with Si2" << endl;
+    return ReadDef(defName);
+  }
+
+  // Si2 for the rest of the file, then the native sections in file order
+  si2_text.clear();
+  const char* pos = begin;
+  for(size_t i = 0; i < sections.size(); i++) {
+    if(pos < sections[i].begin)
+      si2_text.push_back(make_pair(pos, sections[i].begin));
+    pos = sections[i].end;
+  }
+  if(pos < end) si2_text.push_back(make_pair(pos, end));
+  si2_part = 0;
+  si2_pos = si2_text.empty() ? NULL : si2_text[0].first;
+  int res = ReadDef(defName, read_si2_text);
+
+  double native_start = omp_get_wtime();
+  size_t native_size = 0;
+  for(size_t i = 0; i < sections.size(); i++) {
+    read_section(sections[i].kind, sections[i].begin, sections[i].end, this);
+    native_size += sections[i].end - sections[i].begin;
+  }
+  double finish = omp_get_wtime();
+  munmap(mapped, size);
+
+  const double MB = 1024.0 * 1024.0;
+  cout << " mmap DEF reader   : " << size / MB << " MB in " << finish - start
+       << " s ( " << size / MB / (finish - start) << " MB/s ), native "
+       << native_size / MB << " MB at "
+       << native_size / MB / (finish - native_start) << " MB/s" << endl;
+  return res;
+#endif
+}
@@ -0,0 +1,172 @@
+/////////////////////////////////////////////////////////////////////////////
+// Authors: SangGi Do(sanggido@unist.ac.kr), Mingyu Woo(mwoo@eng.ucsd.edu)
+//          (respective Ph.D. advisors: Seokhyeong Kang, Andrew B. Kahng)
+//
+//          Original parsing structure was made by Myung-Chul Kim (IBM).
+//
+// BSD 3-Clause License
+//
+// Copyright (c) 2018, SangGi Do and Mingyu Woo
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "circuit.h"
+
+#define ECO_HALO 3 /* refined neighbourhood around an ECO cell, in rows */
+
+using opendp::circuit;
+using opendp::cell;
+using opendp::rect;
+
+using std::max;
+using std::min;
+using std::cout;
+using std::endl;
+using std::vector;
+using std::pair;
+using std::make_pair;
+
+// ECO legalization ( -eco_def ) : the cells the ECO left where the previous
+// legal DEF had them keep their positions, the new, resized, moved and
+// overlapped ones are legalized around them, and the refinement only runs
+// on the cells near those. Nothing here visits the whole grid.
+void circuit::eco_placement(CMeasure& measure) {
+  // bin densities size the search windows of the placement moves
+  calc_density_factor(4);
+  int unchanged = 0;
+  int moved = 0;
+  int added = 0;
+  int overlapped = 0;
+  vector< cell* > eco_list;
+  for(int i = 0; i < cells.size(); i++) {
+    cell* theCell = &cells[i];
+    if(theCell->isFixed) continue;
+    pair< double, double >& prev = eco_coords[i];
+    if(prev.first < 0) {
+      added++;
+      eco_list.push_back(theCell);
+    }
+    else if(prev.first != theCell->init_x_coord ||
+            prev.second != theCell->init_y_coord) {
+      moved++;
+      eco_list.push_back(theCell);
+    }
+    else if(eco_hold(theCell)) {
+      unchanged++;
+    }
+    else {
+      overlapped++;
+      eco_list.push_back(theCell);
+    }
+  }
+  cout << " eco cells unchanged : " << unchanged << " moved : " << moved
+       << " new or resized : " << added << " overlapped : " << overlapped
+       << endl;
+  measure.stop_clock("eco diff");
+
+  // multi-deck cells first, larger first
+  std::stable_sort(eco_list.begin(), eco_list.end(), [](cell* a, cell* b) {
+    if(a->height != b->height) return a->height > b->height;
+    return a->width > b->width;
+  });
+  for(int i = 0; i < eco_list.size(); i++) {
+    cell* theCell = eco_list[i];
+    if(theCell->isPlaced) continue;
+    if(map_move(theCell, MODE_INIT_COORD) == false)
+      shift_move(theCell, MODE_INIT_COORD);
+  }
+  measure.stop_clock("eco legalization");
+
+  // cells around the legalized ones, one list per placement class
+  vector< cell* > around_list;
+  for(int i = 0; i < eco_list.size(); i++) {
+    cell* theCell = eco_list[i];
+    if(theCell->isPlaced == false) continue;
+    rect theRect;
+    theRect.xLL = max(die.xLL, theCell->x_coord - ECO_HALO * rowHeight);
+    theRect.xUR = min(die.xUR, theCell->x_coord + theCell->width +
+                                   ECO_HALO * rowHeight);
+    theRect.yLL = max(die.yLL, theCell->y_coord - ECO_HALO * rowHeight);
+    theRect.yUR = min(die.yUR, theCell->y_coord + theCell->height +
+                                   ECO_HALO * rowHeight);
+    vector< cell* > region_cells = get_cells_from_boundary(&theRect);
+    around_list.insert(around_list.end(), region_cells.begin(),
+                       region_cells.end());
+  }
+  std::sort(around_list.begin(), around_list.end(),
+            [](cell* a, cell* b) { return a->id < b->id; });
+  around_list.erase(std::unique(around_list.begin(), around_list.end()),
+                    around_list.end());
+
+  std::map< unsigned, vector< cell* > > class_lists;
+  for(int i = 0; i < around_list.size(); i++)
+    class_lists[around_list[i]->group].push_back(around_list[i]);
+
+  refine_stats stats;
+  int count = 0;
+  for(auto& theList : class_lists) {
+    count += assignment_refine(theList.second, stats.pass_moved);
+    count += swap_refine(theList.second, stats);
+  }
+  cout << " eco refinement : " << around_list.size() << " cells, "
+       << stats.swap_accepted << " swaps" << endl;
+  measure.stop_clock("eco refinement");
+  cout << " - - - - - - - - - - - - - - - - - - - - - - - - " << endl;
+  return;
+}
+
+// paints theCell where it is if that is a legal position : a legal start
+// row, and free sites ( of its class ) under its footprint with the edge
+// spacing, the same test the nearest position search makes
+bool circuit::eco_hold(cell* theCell) {
+  int x_pos = (int)floor(theCell->init_x_coord / wsite + 0.5);
+  int y_pos = (int)floor(theCell->init_y_coord / rowHeight + 0.5);
+  if(x_pos * wsite != theCell->init_x_coord ||
+     y_pos * rowHeight != theCell->init_y_coord)
+    return false;
+
+  const start_row_mask* theRows = cell_start_rows(theCell);
+  if(y_pos >= theRows->legal.size() || theRows->legal[y_pos] == false)
+    return false;
+
+  macro* theMacro = &macros[theCell->type];
+  int edge_left = (theMacro->edgetypeLeft == 1) ? 2 : 0;
+  int edge_right = (theMacro->edgetypeRight == 1) ? 2 : 0;
+  int x_step = (int)ceil(theCell->width / wsite) + edge_left + edge_right;
+  int y_step = (int)ceil(theCell->height / rowHeight);
+  int x_start = x_pos - edge_left;
+  free_site_map* theMap = cell_free_sites(theCell);
+  if(theMap->contains(x_start, y_pos) == false ||
+     theMap->contains(x_start + x_step - 1, y_pos + y_step - 1) == false ||
+     theMap->is_free(x_start, y_pos, x_step, y_step) == false)
+    return false;
+
+  paint_pixel(theCell, x_pos, y_pos);
+  return true;
+}
@@ -0,0 +1,606 @@
+/////////////////////////////////////////////////////////////////////////////
+// Authors: SangGi Do(sanggido@unist.ac.kr), Mingyu Woo(mwoo@eng.ucsd.edu)
+//          (respective Ph.D. advisors: Seokhyeong Kang, Andrew B. Kahng)
+//
+//          Original parsing structure was made by Myung-Chul Kim (IBM).
+//
+// BSD 3-Clause License
+//
+// Copyright (c) 2018, SangGi Do and Mingyu Woo
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "circuit.h"
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+using opendp::circuit;
+using opendp::cell;
+using opendp::pixel;
+using opendp::pixel_grid;
+using opendp::group;
+using opendp::free_site_map;
+
+using std::max;
+using std::min;
+using std::cout;
+using std::endl;
+
+typedef free_site_map::word_t word_t;
+
+static const word_t ALL_ONES = ~0ULL;
+
+void free_site_map::init(int x_begin, int y_begin, int x_end, int y_end) {
+  x_begin_ = x_begin - x_begin % WORD_BITS;
+  y_begin_ = y_begin;
+  x_end_ = max(x_end, x_begin_);
+  y_end_ = max(y_end, y_begin_);
+  words_per_row_ = (x_end_ - x_begin_ + WORD_BITS - 1) / WORD_BITS;
+  words_.assign(static_cast< size_t >(words_per_row_) * (y_end_ - y_begin_),
+                0);
+
+  tree_words_ = 1;
+  while(tree_words_ < min(words_per_row_, (int)MAX_TREE_WORDS))
+    tree_words_ *= 2;
+  blocks_per_row_ = (words_per_row_ + tree_words_ - 1) / tree_words_;
+  runs_.assign(static_cast< size_t >(blocks_per_row_) * 2 * tree_words_ *
+                   (y_end_ - y_begin_),
+               run_summary());
+
+  int tile_sites = CAP_TILE_WORDS * WORD_BITS;
+  cap_tiles_ = (x_end_ - x_begin_ + tile_sites - 1) / tile_sites;
+  capacity_.clear();
+  for(int level = 0; level <= CAP_MAX_LEVEL; level++) {
+    int bands = ((y_end_ - y_begin_) + (1 << level) - 1) >> level;
+    capacity_.push_back(std::vector< run_summary >(
+        static_cast< size_t >(bands) * cap_tiles_, run_summary()));
+    if(bands <= 1) break;
+  }
+  return;
+}
+
+bool free_site_map::is_free(int x_pos, int y_pos) const {
+  if(contains(x_pos, y_pos) == false) return false;
+  int bit = x_pos - x_begin_;
+  size_t wi = static_cast< size_t >(y_pos - y_begin_) * words_per_row_ +
+              bit / WORD_BITS;
+  return (words_[wi] >> (bit % WORD_BITS)) & 1;
+}
+
+void free_site_map::set_free(int x_pos, int y_pos, bool free) {
+  if(contains(x_pos, y_pos) == false) return;
+  int bit = x_pos - x_begin_;
+  size_t wi = static_cast< size_t >(y_pos - y_begin_) * words_per_row_ +
+              bit / WORD_BITS;
+  word_t mask = 1ULL << (bit % WORD_BITS);
+  if(free == (bool)(words_[wi] & mask)) return;
+  if(free)
+    words_[wi] |= mask;
+  else
+    words_[wi] &= ~mask;
+  update_runs(y_pos - y_begin_, bit / WORD_BITS);
+
+  update_capacity(y_pos - y_begin_, bit / (CAP_TILE_WORDS * WORD_BITS));
+  return;
+}
+
+// rebuilds the level 0 summary of a tile from the word leaves of the row
+// tree and raises / lowers the band maxima above it
+void free_site_map::update_capacity(int y, int tile) {
+  run_summary theTile;
+  int len = 0;
+  int wi_end = min(words_per_row_, (tile + 1) * CAP_TILE_WORDS);
+  for(int wi = tile * CAP_TILE_WORDS; wi < wi_end; wi++) {
+    const run_summary& leaf =
+        tree(y, wi / tree_words_)[tree_words_ + wi % tree_words_];
+    run_summary merged;
+    merged.prefix =
+        (theTile.prefix == len) ? len + leaf.prefix : theTile.prefix;
+    merged.suffix =
+        (leaf.suffix == WORD_BITS) ? WORD_BITS + theTile.suffix : leaf.suffix;
+    merged.longest = max(max(theTile.longest, leaf.longest),
+                         (unsigned short)(theTile.suffix + leaf.prefix));
+    theTile = merged;
+    len += WORD_BITS;
+  }
+
+  int band = y;
+  run_summary* node = &capacity_[0][static_cast< size_t >(band) * cap_tiles_ +
+                                    tile];
+  for(int level = 0;; level++) {
+    if(node->prefix == theTile.prefix && node->suffix == theTile.suffix &&
+       node->longest == theTile.longest)
+      return;
+    *node = theTile;
+    if(level + 1 == capacity_.size()) return;
+
+    // the parent band is the maximum of its two child bands
+    const std::vector< run_summary >& children = capacity_[level];
+    int sibling = band ^ 1;
+    if(static_cast< size_t >(sibling) * cap_tiles_ < children.size()) {
+      const run_summary& other =
+          children[static_cast< size_t >(sibling) * cap_tiles_ + tile];
+      theTile.prefix = max(theTile.prefix, other.prefix);
+      theTile.suffix = max(theTile.suffix, other.suffix);
+      theTile.longest = max(theTile.longest, other.longest);
+    }
+    band /= 2;
+    node = &capacity_[level + 1][static_cast< size_t >(band) * cap_tiles_ +
+                                 tile];
+  }
+}
+
+// upper bound of the longest free run in the tiles [t_first, t_last] over
+// the rows of a band
+int free_site_map::band_longest(int level, int band, int t_first,
+                                int t_last) const {
+  const int tile_sites = CAP_TILE_WORDS * WORD_BITS;
+  const run_summary* tiles =
+      &capacity_[level][static_cast< size_t >(band) * cap_tiles_];
+  int run = 0;
+  int longest = 0;
+  for(int t = t_first; t <= t_last; t++) {
+    longest = max(longest, max((int)tiles[t].longest, run + tiles[t].prefix));
+    run = (tiles[t].suffix == tile_sites) ? run + tile_sites : tiles[t].suffix;
+  }
+  return longest;
+}
+
+bool free_site_map::has_room(int x_first, int x_last, int y_pos,
+                             int width) const {
+  if(y_pos < y_begin_ || y_pos >= y_end_) return false;
+  x_first = max(x_first, x_begin_);
+  x_last = min(x_last, x_end_ - 1);
+  if(x_last - x_first + 1 < width) return false;
+  const int tile_sites = CAP_TILE_WORDS * WORD_BITS;
+  return band_longest(0, y_pos - y_begin_, (x_first - x_begin_) / tile_sites,
+                      (x_last - x_begin_) / tile_sites) >= width;
+}
+
+// a band without a free run of width sites has no row with room, so the
+// walk climbs to the largest saturated band around the current row and
+// jumps past it
+int free_site_map::next_room_row(int x_first, int x_last, int y_pos,
+                                 int y_limit, int width) const {
+  int dir = (y_limit >= y_pos) ? 1 : -1;
+  x_first = max(x_first, x_begin_);
+  x_last = min(x_last, x_end_ - 1);
+  if(x_last - x_first + 1 < width) return -1;
+  const int tile_sites = CAP_TILE_WORDS * WORD_BITS;
+  int t_first = (x_first - x_begin_) / tile_sites;
+  int t_last = (x_last - x_begin_) / tile_sites;
+
+  // rows out of the map have no free site
+  int y_lo = max(min(y_pos, y_limit), y_begin_);
+  int y_hi = min(max(y_pos, y_limit), y_end_ - 1);
+  if(dir == 1)
+    y_pos = max(y_pos, y_lo);
+  else
+    y_pos = min(y_pos, y_hi);
+
+  while(y_pos >= y_lo && y_pos <= y_hi) {
+    int y = y_pos - y_begin_;
+    if(band_longest(0, y, t_first, t_last) >= width) return y_pos;
+    int level = 0;
+    while(level + 1 < capacity_.size() &&
+          band_longest(level + 1, y >> (level + 1), t_first, t_last) < width)
+      level++;
+    int band = y >> level;
+    if(dir == 1)
+      y_pos = y_begin_ + ((band + 1) << level);
+    else
+      y_pos = y_begin_ + (band << level) - 1;
+  }
+  return -1;
+}
+
+// recomputes the free run lengths of the leaf of word wi and its ancestors
+void free_site_map::update_runs(int y, int wi) {
+  word_t w = words_[static_cast< size_t >(y) * words_per_row_ + wi];
+  run_summary* nodes = tree(y, wi / tree_words_);
+  int node = tree_words_ + wi % tree_words_;
+
+  run_summary& leaf = nodes[node];
+  if(w == ALL_ONES) {
+    leaf.prefix = leaf.suffix = leaf.longest = WORD_BITS;
+  }
+  else {
+    leaf.prefix = __builtin_ctzll(~w);
+    leaf.suffix = __builtin_clzll(~w);
+    int longest = 0;
+    while(w != 0) {
+      int start = __builtin_ctzll(w);
+      word_t rest = ~(w >> start);
+      int len = (rest == 0) ? WORD_BITS - start : __builtin_ctzll(rest);
+      longest = max(longest, len);
+      if(start + len >= WORD_BITS) break;
+      w &= ALL_ONES << (start + len);
+    }
+    leaf.longest = longest;
+  }
+
+  int len = WORD_BITS;
+  for(node /= 2; node > 0; node /= 2) {
+    const run_summary& left = nodes[2 * node];
+    const run_summary& right = nodes[2 * node + 1];
+    run_summary& parent = nodes[node];
+    parent.prefix =
+        (left.prefix == len) ? len + right.prefix : left.prefix;
+    parent.suffix =
+        (right.suffix == len) ? len + left.suffix : right.suffix;
+    parent.longest = max(max(left.longest, right.longest),
+                         (unsigned short)(left.suffix + right.prefix));
+    len *= 2;
+  }
+  return;
+}
+
+// Searches node ( sites [lo, lo + len) ) for the first free run of width
+// sites starting in [from, last]. run is the length of the free run ending
+// right before lo, counted from "from". Returns the start, -1 if the run is
+// not in this node, -2 if no run can start before last any more.
+int free_site_map::node_first(const run_summary* nodes, int y, int node,
+                              int lo, int len, int from, int last, int width,
+                              int& run) const {
+  if(lo + len <= from) return -1;
+  const run_summary& theNode = nodes[node];
+  if(lo >= from) {
+    if(run + theNode.prefix >= width) {
+      return (lo - run <= last) ? lo - run : -2;
+    }
+    // every start left in this row is at or after lo - run
+    if(lo - run > last) return -2;
+    if(theNode.longest < width) {
+      run = (theNode.prefix == len) ? run + len : theNode.suffix;
+      return -1;
+    }
+  }
+
+  if(len == WORD_BITS) {
+    word_t w = words_[static_cast< size_t >(y) * words_per_row_ +
+                      lo / WORD_BITS];
+    if(from > lo) w &= ALL_ONES << (from - lo);
+    int pos = 0;
+    while(pos < WORD_BITS) {
+      word_t rest = w >> pos;
+      if(rest & 1) {
+        int ones = (~rest == 0) ? WORD_BITS - pos : __builtin_ctzll(~rest);
+        if(run + ones >= width) {
+          return (lo + pos - run <= last) ? lo + pos - run : -2;
+        }
+        run = (pos + ones == WORD_BITS) ? run + ones : 0;
+        pos += ones;
+      }
+      else {
+        run = 0;
+        pos += (rest == 0) ? WORD_BITS - pos : __builtin_ctzll(rest);
+      }
+    }
+    return -1;
+  }
+
+  int found =
+      node_first(nodes, y, 2 * node, lo, len / 2, from, last, width, run);
+  if(found != -1) return found;
+  return node_first(nodes, y, 2 * node + 1, lo + len / 2, len / 2, from, last,
+                    width, run);
+}
+
+// mirror of node_first: the last free run of width sites starting in
+// [first, from], run is the free run beginning right after lo + len
+int free_site_map::node_last(const run_summary* nodes, int y, int node, int lo,
+                             int len, int first, int from, int width,
+                             int& run) const {
+  int end = from + width - 1;
+  if(lo > end) return -1;
+  const run_summary& theNode = nodes[node];
+  int hi = lo + len;
+  if(hi - 1 <= end) {
+    if(run + theNode.suffix >= width) {
+      return (hi + run - width >= first) ? hi + run - width : -2;
+    }
+    if(hi + run - width < first) return -2;
+    if(theNode.longest < width) {
+      run = (theNode.suffix == len) ? run + len : theNode.prefix;
+      return -1;
+    }
+  }
+
+  if(len == WORD_BITS) {
+    word_t w = words_[static_cast< size_t >(y) * words_per_row_ +
+                      lo / WORD_BITS];
+    if(end < hi - 1) w &= ALL_ONES >> (hi - 1 - end);
+    int top = WORD_BITS - 1;
+    while(top >= 0) {
+      word_t rest = w << (WORD_BITS - 1 - top);
+      if(rest >> (WORD_BITS - 1)) {
+        int ones = (~rest == 0) ? top + 1 : __builtin_clzll(~rest);
+        if(run + ones >= width) {
+          int start = lo + top + 1 + run - width;
+          return (start >= first) ? start : -2;
+        }
+        run = (ones == top + 1) ? run + ones : 0;
+        top -= ones;
+      }
+      else {
+        run = 0;
+        top -= (rest == 0) ? top + 1 : __builtin_clzll(rest);
+      }
+    }
+    return -1;
+  }
+
+  int found = node_last(nodes, y, 2 * node + 1, lo + len / 2, len / 2, first,
+                        from, width, run);
+  if(found != -1) return found;
+  return node_last(nodes, y, 2 * node, lo, len / 2, first, from, width, run);
+}
+
+int free_site_map::run_first(int y, int from, int last, int width) const {
+  int block_sites = tree_words_ * WORD_BITS;
+  int run = 0;
+  for(int b = from / block_sites; b < blocks_per_row_; b++) {
+    int found = node_first(tree(y, b), y, 1, b * block_sites, block_sites,
+                           from, last, width, run);
+    if(found != -1) return max(found, -1);
+  }
+  return -1;
+}
+
+int free_site_map::run_last(int y, int first, int from, int width) const {
+  int block_sites = tree_words_ * WORD_BITS;
+  int run = 0;
+  int end = min(from + width - 1, words_per_row_ * WORD_BITS - 1);
+  for(int b = end / block_sites; b >= 0; b--) {
+    int found = node_last(tree(y, b), y, 1, b * block_sites, block_sites,
+                          first, from, width, run);
+    if(found != -1) return max(found, -1);
+  }
+  return -1;
+}
+
+word_t free_site_map::row_word(int y, int height, int wi) const {
+  const word_t* w = &words_[static_cast< size_t >(y) * words_per_row_ + wi];
+  word_t result = *w;
+  for(int i = 1; i < height; i++) {
+    w += words_per_row_;
+    result &= *w;
+  }
+  return result;
+}
+
+#ifdef __AVX2__
+// AND of the 4 words from wi of rows [y, y + height)
+static inline __m256i row_words_4(const word_t* words, int words_per_row,
+                                  int y, int height, int wi) {
+  const word_t* w = &words[static_cast< size_t >(y) * words_per_row + wi];
+  __m256i result = _mm256_loadu_si256((const __m256i*)w);
+  for(int i = 1; i < height; i++) {
+    w += words_per_row;
+    result = _mm256_and_si256(result, _mm256_loadu_si256((const __m256i*)w));
+  }
+  return result;
+}
+#endif
+
+// first free bit in [from, last], -1 if there is none
+int free_site_map::next_free(int y, int height, int from, int last) const {
+  if(from > last) return -1;
+  int wi = from / WORD_BITS;
+  int last_wi = last / WORD_BITS;
+  word_t w = row_word(y, height, wi) & (ALL_ONES << (from % WORD_BITS));
+  while(w == 0) {
+    if(++wi > last_wi) return -1;
+#ifdef __AVX2__
+    // skip fully occupied 4 word blocks at once
+    while(wi + 4 <= last_wi) {
+      __m256i block = row_words_4(&words_[0], words_per_row_, y, height, wi);
+      if(_mm256_testz_si256(block, block) == 0) break;
+      wi += 4;
+    }
+#endif
+    w = row_word(y, height, wi);
+  }
+  int bit = wi * WORD_BITS + __builtin_ctzll(w);
+  return (bit <= last) ? bit : -1;
+}
+
+// first used bit in [from, last], last + 1 if there is none
+int free_site_map::next_used(int y, int height, int from, int last) const {
+  if(from > last) return last + 1;
+  int wi = from / WORD_BITS;
+  int last_wi = last / WORD_BITS;
+  word_t w = ~row_word(y, height, wi) & (ALL_ONES << (from % WORD_BITS));
+  while(w == 0) {
+    if(++wi > last_wi) return last + 1;
+#ifdef __AVX2__
+    // skip fully free 4 word blocks at once
+    const __m256i ones = _mm256_set1_epi64x(-1);
+    while(wi + 4 <= last_wi) {
+      __m256i block = row_words_4(&words_[0], words_per_row_, y, height, wi);
+      if(_mm256_testc_si256(block, ones) == 0) break;
+      wi += 4;
+    }
+#endif
+    w = ~row_word(y, height, wi);
+  }
+  int bit = wi * WORD_BITS + __builtin_ctzll(w);
+  return min(bit, last + 1);
+}
+
+// last free bit in [first, from], -1 if there is none
+int free_site_map::prev_free(int y, int height, int from, int first) const {
+  if(from < first) return -1;
+  int wi = from / WORD_BITS;
+  int first_wi = first / WORD_BITS;
+  word_t w = row_word(y, height, wi) &
+             (ALL_ONES >> (WORD_BITS - 1 - from % WORD_BITS));
+  while(w == 0) {
+    if(--wi < first_wi) return -1;
+    w = row_word(y, height, wi);
+  }
+  int bit = wi * WORD_BITS + WORD_BITS - 1 - __builtin_clzll(w);
+  return (bit >= first) ? bit : -1;
+}
+
+// last used bit in [first, from], first - 1 if there is none
+int free_site_map::prev_used(int y, int height, int from, int first) const {
+  if(from < first) return first - 1;
+  int wi = from / WORD_BITS;
+  int first_wi = first / WORD_BITS;
+  word_t w = ~row_word(y, height, wi) &
+             (ALL_ONES >> (WORD_BITS - 1 - from % WORD_BITS));
+  while(w == 0) {
+    if(--wi < first_wi) return first - 1;
+    w = ~row_word(y, height, wi);
+  }
+  int bit = wi * WORD_BITS + WORD_BITS - 1 - __builtin_clzll(w);
+  return max(bit, first - 1);
+}
+
+bool free_site_map::is_free(int x_pos, int y_pos, int width,
+                            int height) const {
+  if(x_pos < x_begin_ || x_pos + width > x_end_) return false;
+  if(y_pos < y_begin_ || y_pos + height > y_end_) return false;
+  int from = x_pos - x_begin_;
+  int last = from + width - 1;
+  return next_used(y_pos - y_begin_, height, from, last) > last;
+}
+
+// the free segment index of row y_pos proposes a start, the other rows of a
+// multi-row footprint are checked word-wide and the search resumes after the
+// used site that rejected it
+int free_site_map::find_first(int x_first, int x_last, int y_pos, int width,
+                              int height) const {
+  if(y_pos < y_begin_ || y_pos + height > y_end_) return -1;
+  int y = y_pos - y_begin_;
+  int first = max(x_first, x_begin_) - x_begin_;
+  // the footprint has to end inside the map
+  int last = min(x_last, x_end_ - width) - x_begin_;
+
+  while(first <= last) {
+    int start = run_first(y, first, last, width);
+    if(start < 0) return -1;
+    if(height == 1) return start + x_begin_;
+    int used = next_used(y, height, start, start + width - 1);
+    if(used >= start + width) return start + x_begin_;
+    first = used + 1;
+  }
+  return -1;
+}
+
+int free_site_map::find_last(int x_first, int x_last, int y_pos, int width,
+                             int height) const {
+  if(y_pos < y_begin_ || y_pos + height > y_end_) return -1;
+  int y = y_pos - y_begin_;
+  int first = max(x_first, x_begin_) - x_begin_;
+  int last = min(x_last, x_end_ - width) - x_begin_;
+
+  while(first <= last) {
+    int start = run_last(y, first, last, width);
+    if(start < 0) return -1;
+    if(height == 1) return start + x_begin_;
+    int used = prev_used(y, height, start + width - 1, start);
+    if(used < start) return start + x_begin_;
+    last = used - width;
+  }
+  return -1;
+}
+
+void free_site_map::free_runs(int y_pos,
+                              std::vector< std::pair< int, int > >& runs) const {
+  runs.clear();
+  if(y_pos < y_begin_ || y_pos >= y_end_) return;
+  int y = y_pos - y_begin_;
+  int last = x_end_ - x_begin_ - 1;
+  int x = 0;
+  while(x <= last) {
+    int begin = next_free(y, 1, x, last);
+    if(begin < 0) break;
+    int end = next_used(y, 1, begin, last);
+    runs.push_back(std::make_pair(begin + x_begin_, end + x_begin_));
+    x = end + 1;
+  }
+  return;
+}
+
+// builds the free site bitmaps from the pixel grid, called once the fixed
+// cells and the fence regions are assigned
+void circuit::init_free_sites() {
+  free_sites.clear();
+  free_sites.resize(groups.size() + 1);
+
+  for(int i = 0; i < groups.size(); i++) {
+    group* theGroup = &groups[i];
+    int x_begin = max(0, (int)floor(theGroup->boundary.xLL / wsite));
+    int x_end = min(grid.num_cols(), (int)ceil(theGroup->boundary.xUR / wsite));
+    int y_begin = max(0, (int)floor(theGroup->boundary.yLL / rowHeight));
+    int y_end =
+        min(grid.num_rows(), (int)ceil(theGroup->boundary.yUR / rowHeight));
+    free_sites[i].init(x_begin, y_begin, x_end, y_end);
+  }
+  free_sites[groups.size()].init(0, 0, grid.num_cols(), grid.num_rows());
+
+  // shared tiles have no free site
+  for(int i = 0; i < grid.tiles_y(); i++) {
+    for(int j = 0; j < grid.tiles_x(); j++) {
+      if(grid.is_shared(j, i)) continue;
+      int y_end = min(grid.num_rows(), (i + 1) * pixel_grid::TILE_ROWS);
+      int x_end = min(grid.num_cols(), (j + 1) * pixel_grid::TILE_COLS);
+      for(int y = i * pixel_grid::TILE_ROWS; y < y_end; y++) {
+        for(int x = j * pixel_grid::TILE_COLS; x < x_end; x++) {
+          update_free_site(x, y);
+        }
+      }
+    }
+  }
+
+  size_t usage = 0;
+  for(int i = 0; i < free_sites.size(); i++) {
+    usage += free_sites[i].memory_usage();
+  }
+  cout << " free site maps    : " << free_sites.size() << " ( "
+       << usage / 1048576.0 << " MB )" << endl;
+  return;
+}
+
+free_site_map* circuit::cell_free_sites(cell* theCell) {
+  if(theCell->inGroup == true) return &free_sites[theCell->group];
+  return &free_sites[groups.size()];
+}
+
+// re-derives the free bit of a pixel after its cell is painted / erased
+void circuit::update_free_site(int x_pos, int y_pos) {
+  const pixel* thePixel = get_pixel(x_pos, y_pos);
+  unsigned theClass =
+      (thePixel->group == PIXEL_NO_GROUP) ? groups.size() : thePixel->group;
+  free_sites[theClass].set_free(x_pos, y_pos,
+                                thePixel->isEmpty() && thePixel->isValid());
+  return;
+}
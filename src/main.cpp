@@ -72,13 +72,16 @@ int main(int argc, char* argv[]) {
   ckt.read_files(argc, argv);
   measure.stop_clock("Parser");
 
-  ckt.simple_placement(measure);
-  ckt.calc_density_factor(4);
+  if(ckt.eco_def_name == "")
+    ckt.simple_placement(measure);
+  else
+    ckt.eco_placement(measure);
 
   measure.stop_clock("All");
   ckt.write_def(ckt.out_def_name);
 
   measure.print_clock();
+  measure.printMemoryUsage();
 
   // EVALUATION - utility.cpp
   ckt.evaluation();
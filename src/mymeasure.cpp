@@ -13,6 +13,7 @@
 #include <ios>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <ctime>
 #include <vector>
@@ -180,38 +181,25 @@ void CMeasure::print_clock() {
   fflush(stdout);
 }
 
+// prints the peak virtual / resident memory of this process.
+// /proc/self/status is searched by key, its line layout differs by kernel.
 void CMeasure::printMemoryUsage(void) {
   ifstream status("/proc/self/status");
   string data;
 
-  if(status.good()) {
-    for(int i = 0; i < 2; ++i) getline(status, data);
+  while(status.good() && getline(status, data)) {
+    if(data.compare(0, 7, "VmPeak:") != 0 && data.compare(0, 6, "VmHWM:") != 0)
+      continue;
 
-    // account for login and loginlinux versions
-    getline(status, data);
-    if(data.find("SleeAVG") == string::npos)
-      for(int i = 0; i < 7; ++i) getline(status, data);
-    else
-      for(int i = 0; i < 6; ++i) getline(status, data);
-
-    // vmPeak
-    getline(status, data);
-    cout << endl << "----------------------------------------";
-    cout << endl << "### VmPeak\t\t\t: " << data << endl;
-  }
-  status.close();
-
-  status.open("/proc/self/stat");
-  if(status.good()) {
-    double vmsize;
-    for(unsigned i = 0; i < 22; ++i) {
-      status >> data;
-    }
-    status >> vmsize;
-
-    cout << "### Memory Usage\t: " << vmsize / 1048576. << " MB" << endl;
+    string key;
+    double kb = 0.0;
+    std::istringstream line(data);
+    line >> key >> kb;
+    key = (key == "VmPeak:") ? "peak virtual memory" : "peak resident memory";
+    printf(" %-25s %10.3f MB\n", key.c_str(), kb / 1024.0);
   }
   status.close();
+  fflush(stdout);
 }
 
 void CMeasure::print_only(string task) {
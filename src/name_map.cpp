@@ -0,0 +1,82 @@
+/////////////////////////////////////////////////////////////////////////////
+// Authors: SangGi Do(sanggido@unist.ac.kr), Mingyu Woo(mwoo@eng.ucsd.edu)
+//          (respective Ph.D. advisors: Seokhyeong Kang, Andrew B. Kahng)
+//
+//          Original parsing structure was made by Myung-Chul Kim (IBM).
+//
+// BSD 3-Clause License
+//
+// Copyright (c) 2018, SangGi Do and Mingyu Woo
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "circuit.h"
+
+using opendp::name_view;
+using opendp::name_arena;
+using opendp::name_ops;
+
+using std::max;
+using std::ostream;
+
+// names are copied into blocks of this size, or into a block of their own
+// when longer
+static const size_t arena_block_size = 64 * 1024;
+
+name_arena::~name_arena() {
+  for(size_t i = 0; i < blocks_.size(); i++) delete[] blocks_[i];
+}
+
+name_view name_arena::intern(const name_view& name) {
+  size_t need = (size_t)name.size + 1;
+  if(blocks_.empty() || used_ + need > capacity_) {
+    capacity_ = max(arena_block_size, need);
+    blocks_.push_back(new char[capacity_]);
+    memory_ += capacity_;
+    used_ = 0;
+  }
+  char* str = blocks_.back() + used_;
+  memcpy(str, name.c_str(), name.size);
+  str[name.size] = '\0';
+  used_ += need;
+  return name_view(str, name.size);
+}
+
+// FNV-1a
+size_t name_ops::hash(const name_view& key) {
+  size_t h = 14695981039346656037ULL;
+  for(unsigned i = 0; i < key.size; i++) {
+    h ^= (unsigned char)key.data[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+ostream& opendp::operator<<(ostream& os, const name_view& name) {
+  return os.write(name.c_str(), name.size);
+}
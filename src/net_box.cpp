@@ -0,0 +1,263 @@
+/////////////////////////////////////////////////////////////////////////////
+// Authors: SangGi Do(sanggido@unist.ac.kr), Mingyu Woo(mwoo@eng.ucsd.edu)
+//          (respective Ph.D. advisors: Seokhyeong Kang, Andrew B. Kahng)
+//
+//          Original parsing structure was made by Myung-Chul Kim (IBM).
+//
+// BSD 3-Clause License
+//
+// Copyright (c) 2018, SangGi Do and Mingyu Woo
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "circuit.h"
+
+using opendp::circuit;
+using opendp::cell;
+using opendp::net;
+using opendp::pin;
+using opendp::net_box;
+using opendp::cell_move;
+using opendp::moved_pin;
+
+using std::max;
+using std::min;
+using std::cout;
+using std::endl;
+using std::vector;
+using std::pair;
+using std::make_pair;
+
+// Net bounding boxes kept with the number of pins on each side. A pin
+// leaving a side that still has other pins on it, or moving anywhere
+// inside the box, is an O(1) update; only the last pin leaving a side
+// makes the net scan its pins in the netlist. Pins are taken at the cell
+// position the boxes last saw ( box_coords ), which paint_pixel moves, so
+// the boxes don't follow the cells through erase_pixel. The HPWL total is
+// exact in integer DBU.
+
+namespace {
+
+// one side of a box with a set of pins moved : rest ( the side without
+// the moved pins ) and count, then the moved pins added back in
+struct box_side {
+  long long value;
+  int count;
+};
+
+void add_low(box_side& side, long long value) {
+  if(value < side.value) {
+    side.value = value;
+    side.count = 1;
+  }
+  else if(value == side.value) {
+    side.count++;
+  }
+}
+
+void add_high(box_side& side, long long value) {
+  if(value > side.value) {
+    side.value = value;
+    side.count = 1;
+  }
+  else if(value == side.value) {
+    side.count++;
+  }
+}
+
+}  // namespace
+
+// the pins of each cell are gathered from the netlist
+void circuit::init_net_boxes() {
+  unsigned io_owner = cells.size();
+  cell_pin_start.assign(cells.size() + 1, 0);
+  for(int p = 0; p < net_pin_owner.size(); p++)
+    if(net_pin_owner[p] != io_owner) cell_pin_start[net_pin_owner[p] + 1]++;
+  for(int i = 0; i < cells.size(); i++)
+    cell_pin_start[i + 1] += cell_pin_start[i];
+  cell_pin_nets.resize(cell_pin_start.back());
+  cell_pin_offsets.resize(cell_pin_start.back());
+  vector< unsigned > fill(cell_pin_start.begin(), cell_pin_start.end() - 1);
+  for(int i = 0; i < nets.size(); i++) {
+    for(unsigned p = net_pin_start[i]; p < net_pin_start[i + 1]; p++) {
+      unsigned owner = net_pin_owner[p];
+      if(owner == io_owner) continue;
+      cell_pin_offsets[fill[owner]] = make_pair(net_pin_x[p], net_pin_y[p]);
+      cell_pin_nets[fill[owner]++] = i;
+    }
+  }
+
+  box_coords.resize(cells.size() + 1);
+  for(int i = 0; i < cells.size(); i++)
+    box_coords[i] = make_pair(cells[i].x_coord, cells[i].y_coord);
+  box_coords[io_owner] = make_pair(0, 0);
+
+  net_boxes.resize(nets.size());
+  cached_hpwl = 0;
+  for(int i = 0; i < nets.size(); i++) {
+    net_boxes[i] = scan_net_box(i, NULL, 0);
+    cached_hpwl += net_boxes[i].hpwl();
+  }
+  return;
+}
+
+void circuit::clear_net_boxes() {
+  net_boxes.clear();
+  return;
+}
+
+// box of the net over its pins, leaving out the pins of the moved cells
+net_box circuit::scan_net_box(unsigned net_id, const cell_move* moves,
+                              int num_moves) {
+  net_box box;
+  for(unsigned p = net_pin_start[net_id]; p < net_pin_start[net_id + 1];
+      p++) {
+    unsigned owner = net_pin_owner[p];
+    bool moved = false;
+    for(int k = 0; k < num_moves; k++)
+      moved = moved || (moves[k].theCell->id == owner);
+    if(moved) continue;
+    box.add((long long)box_coords[owner].first + net_pin_x[p],
+            (long long)box_coords[owner].second + net_pin_y[p]);
+  }
+  return box;
+}
+
+// box of the net once the moved cells are at their new positions. moves
+// holds every moved cell, net_pins their pins on net_id
+net_box circuit::moved_net_box(unsigned net_id, const cell_move* moves,
+                               int num_moves, const moved_pin* net_pins,
+                               int num_pins) {
+  net_box& box = net_boxes[net_id];
+  box_side sides[4] = {{box.xLL, box.n_xLL},
+                       {box.xUR, box.n_xUR},
+                       {box.yLL, box.n_yLL},
+                       {box.yUR, box.n_yUR}};
+  // take the moved pins out
+  for(int i = 0; i < num_pins; i++) {
+    const moved_pin& thePin = net_pins[i];
+    if(thePin.x_coord == sides[0].value) sides[0].count--;
+    if(thePin.x_coord == sides[1].value) sides[1].count--;
+    if(thePin.y_coord == sides[2].value) sides[2].count--;
+    if(thePin.y_coord == sides[3].value) sides[3].count--;
+  }
+  if(sides[0].count == 0 || sides[1].count == 0 || sides[2].count == 0 ||
+     sides[3].count == 0) {
+    net_box rest = scan_net_box(net_id, moves, num_moves);
+    sides[0].value = rest.xLL;
+    sides[0].count = rest.n_xLL;
+    sides[1].value = rest.xUR;
+    sides[1].count = rest.n_xUR;
+    sides[2].value = rest.yLL;
+    sides[2].count = rest.n_yLL;
+    sides[3].value = rest.yUR;
+    sides[3].count = rest.n_yUR;
+  }
+  // and back in at their new positions
+  for(int i = 0; i < num_pins; i++) {
+    add_low(sides[0], net_pins[i].new_x);
+    add_high(sides[1], net_pins[i].new_x);
+    add_low(sides[2], net_pins[i].new_y);
+    add_high(sides[3], net_pins[i].new_y);
+  }
+  net_box result;
+  result.xLL = sides[0].value;
+  result.n_xLL = sides[0].count;
+  result.xUR = sides[1].value;
+  result.n_xUR = sides[1].count;
+  result.yLL = sides[2].value;
+  result.n_yLL = sides[2].count;
+  result.yUR = sides[3].value;
+  result.n_yUR = sides[3].count;
+  return result;
+}
+
+// pins of the moved cells, sorted by net
+void circuit::moved_pins(const cell_move* moves, int num_moves) {
+  box_pins.clear();
+  for(int k = 0; k < num_moves; k++) {
+    cell* theCell = moves[k].theCell;
+    const pair< int, int >& coord = box_coords[theCell->id];
+    for(unsigned p = cell_pin_start[theCell->id];
+        p < cell_pin_start[theCell->id + 1]; p++) {
+      const pair< int, int >& offset = cell_pin_offsets[p];
+      moved_pin thePin = {cell_pin_nets[p],
+                          coord.first + offset.first,
+                          coord.second + offset.second,
+                          moves[k].x_coord + offset.first,
+                          moves[k].y_coord + offset.second};
+      box_pins.push_back(thePin);
+    }
+  }
+  // a single cell's pins are already in net order
+  if(num_moves > 1) std::sort(box_pins.begin(), box_pins.end());
+  return;
+}
+
+// HPWL change if the cells were moved, in DBU. nothing is changed
+long long circuit::delta_hpwl(const cell_move* moves, int num_moves) {
+  moved_pins(moves, num_moves);
+  long long delta = 0;
+  for(int i = 0, j = 0; i < box_pins.size(); i = j) {
+    unsigned net_id = box_pins[i].net_id;
+    while(j < box_pins.size() && box_pins[j].net_id == net_id) j++;
+    delta += moved_net_box(net_id, moves, num_moves, &box_pins[i], j - i)
+                 .hpwl() -
+             net_boxes[net_id].hpwl();
+  }
+  return delta;
+}
+
+long long circuit::delta_hpwl(cell* theCell, int x_coord, int y_coord) {
+  cell_move move = {theCell, x_coord, y_coord};
+  return delta_hpwl(&move, 1);
+}
+
+long long circuit::delta_hpwl(cell* cellA, cell* cellB) {
+  cell_move moves[2] = {{cellA, cellB->x_coord, cellB->y_coord},
+                        {cellB, cellA->x_coord, cellA->y_coord}};
+  return delta_hpwl(moves, 2);
+}
+
+// paint_pixel hook : theCell's pins move from box_coords to its position
+void circuit::update_net_boxes(cell* theCell) {
+  cell_move move = {theCell, theCell->x_coord, theCell->y_coord};
+  pair< int, int >& coord = box_coords[theCell->id];
+  if(coord.first == move.x_coord && coord.second == move.y_coord) return;
+  moved_pins(&move, 1);
+  for(int i = 0, j = 0; i < box_pins.size(); i = j) {
+    unsigned net_id = box_pins[i].net_id;
+    while(j < box_pins.size() && box_pins[j].net_id == net_id) j++;
+    net_box box = moved_net_box(net_id, &move, 1, &box_pins[i], j - i);
+    cached_hpwl += box.hpwl() - net_boxes[net_id].hpwl();
+    net_boxes[net_id] = box;
+  }
+  coord = make_pair(move.x_coord, move.y_coord);
+  return;
+}
@@ -0,0 +1,138 @@
+/////////////////////////////////////////////////////////////////////////////
+// Authors: SangGi Do(sanggido@unist.ac.kr), Mingyu Woo(mwoo@eng.ucsd.edu)
+//          (respective Ph.D. advisors: Seokhyeong Kang, Andrew B. Kahng)
+//
+//          Original parsing structure was made by Myung-Chul Kim (IBM).
+//
+// BSD 3-Clause License
+//
+// Copyright (c) 2018, SangGi Do and Mingyu Woo
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "circuit.h"
+
+using opendp::circuit;
+using opendp::cell;
+using opendp::net;
+using opendp::pin;
+
+using std::max;
+using std::min;
+using std::vector;
+
+// The nets flattened once after parsing. A pin position is one gather from
+// the cell coordinate array plus a DBU offset, with no pin type to test :
+// IO pins are owned by a last coordinate entry that stays at ( 0, 0 ), and
+// their offset is their position. Port centres are rounded to DBU.
+
+void circuit::build_netlist() {
+  unsigned io_owner = cells.size();
+  net_pin_start.assign(nets.size() + 1, 0);
+  net_pin_owner.clear();
+  net_pin_x.clear();
+  net_pin_y.clear();
+  for(int i = 0; i < nets.size(); i++) {
+    net* theNet = &nets[i];
+    for(int j = -1; j < (int)theNet->sinks.size(); j++) {
+      pin* thePin = &pins[(j < 0) ? theNet->source : theNet->sinks[j]];
+      if(thePin->type == NONPIO_PIN) {
+        net_pin_owner.push_back(thePin->owner);
+        net_pin_x.push_back(
+            (int)floor(thePin->x_offset * DEFdist2Microns + 0.5));
+        net_pin_y.push_back(
+            (int)floor(thePin->y_offset * DEFdist2Microns + 0.5));
+      }
+      else {
+        net_pin_owner.push_back(io_owner);
+        net_pin_x.push_back((int)floor(thePin->x_coord + 0.5));
+        net_pin_y.push_back((int)floor(thePin->y_coord + 0.5));
+      }
+    }
+    net_pin_start[i + 1] = net_pin_owner.size();
+  }
+  return;
+}
+
+// coordinate arrays of the cells for the netlist : init_coord or coord,
+// with the IO owner entry at the end
+void circuit::cell_coords(bool init_coord, vector< int >& x,
+                          vector< int >& y) {
+  x.resize(cells.size() + 1);
+  y.resize(cells.size() + 1);
+#pragma omp parallel for num_threads(num_cpu)
+  for(int i = 0; i < cells.size(); i++) {
+    x[i] = init_coord ? cells[i].init_x_coord : cells[i].x_coord;
+    y[i] = init_coord ? cells[i].init_y_coord : cells[i].y_coord;
+  }
+  x[cells.size()] = 0;
+  y[cells.size()] = 0;
+  return;
+}
+
+// HPWL of nets [ first, last ) in DBU. The min / max reductions over a net's
+// pins are vectorized, the pins read through net_pin_owner are gathers
+long long circuit::nets_hpwl(const int* x, const int* y, int first,
+                             int last) {
+  const unsigned* owner = net_pin_owner.data();
+  const int* pin_x = net_pin_x.data();
+  const int* pin_y = net_pin_y.data();
+  long long hpwl = 0;
+  for(int i = first; i < last; i++) {
+    int begin = net_pin_start[i];
+    int end = net_pin_start[i + 1];
+    if(begin == end) continue;
+    int xLL = INT_MAX, xUR = INT_MIN;
+    int yLL = INT_MAX, yUR = INT_MIN;
+#pragma omp simd reduction(min : xLL, yLL) reduction(max : xUR, yUR)
+    for(int p = begin; p < end; p++) {
+      int px = x[owner[p]] + pin_x[p];
+      int py = y[owner[p]] + pin_y[p];
+      xLL = (px < xLL) ? px : xLL;
+      xUR = (px > xUR) ? px : xUR;
+      yLL = (py < yLL) ? py : yLL;
+      yUR = (py > yUR) ? py : yUR;
+    }
+    hpwl += (long long)xUR - xLL + yUR - yLL;
+  }
+  return hpwl;
+}
+
+// nets_hpwl over every net, in fixed size chunks summed in order
+long long circuit::total_hpwl(const vector< int >& x, const vector< int >& y) {
+  const int chunk = 4096;
+  int num_chunks = (nets.size() + chunk - 1) / chunk;
+  vector< long long > parts(num_chunks, 0);
+#pragma omp parallel for num_threads(num_cpu) schedule(dynamic)
+  for(int c = 0; c < num_chunks; c++)
+    parts[c] = nets_hpwl(x.data(), y.data(), c * chunk,
+                         min((int)nets.size(), (c + 1) * chunk));
+  long long hpwl = 0;
+  for(int c = 0; c < num_chunks; c++) hpwl += parts[c];
+  return hpwl;
+}
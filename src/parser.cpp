@@ -83,6 +83,11 @@ void circuit::print_usage() {
   cout << "Usage2 : opendp -lef design.lef -def placed.def -cpu 4 "
           "-placement_constraints placement.constraints -output_def lg.def"
        << endl;
+  cout << "Options : -legalizer pixel ( default ) | abacus" << endl;
+  cout << "          -seed 777 ( default )" << endl;
+  cout << "          -hpwl_weight 0.0 ( default )" << endl;
+  cout << "          -eco_def previous_legal.def ( ECO legalization )" << endl;
+  cout << "          -def_reader si2 ( default ) | mmap" << endl;
 
   return;
 }
@@ -103,6 +108,19 @@ void circuit::read_files(int argc, char* argv[]) {
     if(i + 1 != argc) {
       if(strncmp(argv[i], "-lef", 4) == 0)
         lefStor.push_back( argv[++i] );
+      // before -def, which it starts with
+      else if(strncmp(argv[i], "-def_reader", 11) == 0) {
+        string reader_str = argv[++i];
+        if(reader_str == "mmap")
+          def_reader = DEF_READER_MMAP;
+        else if(reader_str == "si2")
+          def_reader = DEF_READER_SI2;
+        else {
+          cerr << "read_files :: unknown DEF reader " << reader_str << endl;
+          print_usage();
+          exit(1);
+        }
+      }
       else if(strncmp(argv[i], "-def", 4) == 0)
         defLoc = argv[++i];
       else if(strncmp(argv[i], "-cpu", 4) == 0)
@@ -113,6 +131,24 @@ void circuit::read_files(int argc, char* argv[]) {
         out_def = argv[++i];
       else if(strncmp(argv[i], "-group_ignore", 13) == 0)
         GROUP_IGNORE = true;
+      else if(strncmp(argv[i], "-seed", 5) == 0)
+        seed = atoi(argv[++i]);
+      else if(strncmp(argv[i], "-hpwl_weight", 12) == 0)
+        hpwl_weight = atof(argv[++i]);
+      else if(strncmp(argv[i], "-eco_def", 8) == 0)
+        eco_def_name = argv[++i];
+      else if(strncmp(argv[i], "-legalizer", 10) == 0) {
+        string engine_str = argv[++i];
+        if(engine_str == "abacus")
+          engine = ENGINE_ABACUS;
+        else if(engine_str == "pixel")
+          engine = ENGINE_PIXEL;
+        else {
+          cerr << "read_files :: unknown legalizer " << engine_str << endl;
+          print_usage();
+          exit(1);
+        }
+      }
     }
   }
 
@@ -138,6 +174,7 @@ void circuit::read_files(int argc, char* argv[]) {
   ReadLef(lefStor);
 
   if(constraints != NULL) constraints_str = constraints;
+  if(cpu != NULL) num_cpu = max(1, atoi(cpu));
 
   in_def_name = defLoc;
   size_t def_found = defLoc.find_last_of("/\\");
@@ -161,6 +198,8 @@ void circuit::read_files(int argc, char* argv[]) {
     cout << " lef               : " << curLefLoc << endl;
   }
   cout << " def               : " << defLoc << endl;
+  if(eco_def_name != "")
+    cout << " eco def           : " << eco_def_name << endl;
 
   if(constraints != NULL)
     cout << " constraints       : " << constraints_str << endl;
@@ -170,7 +209,11 @@ void circuit::read_files(int argc, char* argv[]) {
   // read_def shuld after read_lef
 //  read_def(defLoc, INIT);
   
-  ReadDef(defLoc );
+  if(def_reader == DEF_READER_MMAP)
+    read_def_mmap(defLoc);
+  else
+    ReadDef(defLoc );
+  if(eco_def_name != "") ReadEcoDef(eco_def_name);
 //  exit(1);
 
   if(size != NULL) {
@@ -178,6 +221,8 @@ void circuit::read_files(int argc, char* argv[]) {
     read_def_size(size_file);
   }
   power_mapping();
+  init_start_rows();
+  build_netlist();
 
   if(constraints != NULL) read_constraints(constraints_str);
 
@@ -185,7 +230,6 @@ void circuit::read_files(int argc, char* argv[]) {
   calc_design_area_stats();
 
   // dummy cell generation
-  dummy_cell.name = "FIXED_DUMMY";
   dummy_cell.isFixed = true;
   dummy_cell.isPlaced = true;
 
@@ -196,20 +240,10 @@ void circuit::read_files(int argc, char* argv[]) {
   // construct pixel grid
   int row_num = ty / rowHeight;
   int col = rx / wsite;
-  grid = new pixel*[row_num];
-  for(int i = 0; i < row_num; i++) {
-    grid[i] = new pixel[col];
-  }
-
-  for(int i = 0; i < row_num; i++) {
-    for(int j = 0; j < col; j++) {
-      grid[i][j].name = "pixel_" + to_string(i) + "_" + to_string(j);
-      grid[i][j].y_pos = i;
-      grid[i][j].x_pos = j;
-      grid[i][j].linked_cell = NULL;
-      grid[i][j].isValid = false;
-    }
-  }
+  pixel invalid_pixel;
+  invalid_pixel.setValid(false);
+  grid.init(row_num, col, invalid_pixel);
+  share_blocked_tiles();
 
   // Fragmented Row Handling
   for(auto& curFragRow : prevrows) {
@@ -225,7 +259,7 @@ void circuit::read_files(int argc, char* argv[]) {
 //    cout << "y_end: " << y_end << endl;
     for(int i=x_start; i<x_end; i++) {
       for(int j=y_start; j<y_end; j++) {
-        grid[j][i].isValid = true;
+        if(grid.is_blocked(i, j) == false) edit_pixel(i, j)->setValid(true);
       }
     }
   }
@@ -239,7 +273,7 @@ void circuit::read_files(int argc, char* argv[]) {
     for(int j = 0; j < col_size; j++) {
       int y_pos = (myRow->origY-core.yLL) / rowHeight;
       int x_pos = j + (myRow->origX-core.xLL) / wsite;
-      grid[y_pos][x_pos].isValid = true;
+      edit_pixel(x_pos, y_pos)->setValid(true);
     }
   }
   */
@@ -250,6 +284,11 @@ void circuit::read_files(int argc, char* argv[]) {
   group_pixel_assign_2();
   // y axis dummycell insertion
   group_pixel_assign();
+  init_free_sites();
+
+  cout << " pixel grid        : " << row_num << " x " << col << " ( "
+       << grid.num_allocated_tiles() << " / " << grid.tiles_x() * grid.tiles_y()
+       << " tiles, " << grid.memory_usage() / 1048576.0 << " MB )" << endl;
 
   init_large_cell_stor();
   return;
@@ -292,7 +331,7 @@ void circuit::calc_design_area_stats() {
     macro* theMacro = &macros[theCell->type];
     if(theCell->isFixed == false && 
         theMacro->isMulti == true && 
-        theMacro->type == "CORE") {
+        theMacro->type == CLASS_CORE) {
       if(max_cell_height <
          static_cast< int >(theMacro->height * DEFdist2Microns / rowHeight +
                             0.5))
@@ -461,7 +500,7 @@ void circuit::read_def(const string& input, bool mode) {
         myRow->site = site2id[tokens[1]];
         myRow->origX = atoi(tokens[2].c_str());
         myRow->origY = atoi(tokens[3].c_str());
-        myRow->siteorient = tokens[4];
+        myRow->siteorient = orient_from_str(tokens[4]);
   
         if( fabs(rowHeight - 0.0f) <= numeric_limits<double>::epsilon() ) {
           rowHeight = sites[myRow->site].height 
@@ -693,7 +732,7 @@ void circuit::read_init_def_components(ifstream& is) {
           myCell->y_coord = atoi(tokens[2].c_str());
           myCell->isPlaced = true;
         }
-        myCell->cellorient = tokens[4];
+        myCell->cellorient = orient_from_str(tokens[4]);
       }
     }
     else if(!strcmp(tokens[0].c_str(), DEFLineEndingChar)) {
@@ -747,7 +786,7 @@ void circuit::read_final_def_components(ifstream& is) {
         myCell->y_coord = atoi(tokens[2].c_str());
         myCell->x_pos = myCell->x_coord / wsite;
         myCell->y_pos = myCell->y_coord / rowHeight;
-        myCell->cellorient = tokens[4];
+        myCell->cellorient = orient_from_str(tokens[4]);
         // NOTE: this contest does not allow flipping/rotation
         // assert(myCell->cellorient == "N");
       }
@@ -949,7 +988,7 @@ void circuit::read_def_nets(ifstream& is) {
         myPin->owner = cell2id[tokens[1]];
 
 #ifdef DEBUG
-        cout << "owner name : " << cells[myPin->owner].name << endl;
+        cout << "owner name : " << cell_names[myPin->owner] << endl;
         cout << "mypin name : " << myPin->name << endl;
 #endif
         myPin->type = NONPIO_PIN;
@@ -982,7 +1021,7 @@ void circuit::read_def_nets(ifstream& is) {
         if(tokens[0] != "PIN") {
           myPin->owner = cell2id[tokens[0]];
 #ifdef DEBUG
-          cout << "owner name : " << cells[myPin->owner].name << endl;
+          cout << "owner name : " << cell_names[myPin->owner] << endl;
           cout << "mypin name : " << myPin->name << endl;
 #endif
           myPin->type = NONPIO_PIN;
@@ -1090,10 +1129,10 @@ void circuit::read_def_groups(ifstream& is) {
         myGroup->tag = tokens[0].c_str();
         for(int i = 0; i < cells.size(); i++) {
           cell* theCell = &cells[i];
-          if(strncmp(myGroup->tag.c_str(), theCell->name.c_str(),
+          if(strncmp(myGroup->tag.c_str(), cell_name(theCell).c_str(),
                      myGroup->tag.size() - 1) == 0) {
             myGroup->siblings.push_back(theCell);
-            theCell->group = myGroup->name;
+            theCell->group = group2id[myGroup->name];
             theCell->inGroup = true;
           }
         }
@@ -1658,8 +1697,7 @@ void circuit::read_def_vias(ifstream& is) {
     if(tokens[0] == "-") {
       pass = false;
       get_next_token(is, tokens[0], DEFCommentChar);
-      OPENDP_HASH_MAP< string, unsigned >::iterator it =
-          via2id.find(tokens[0].c_str());
+      opendp::name_map::iterator it = via2id.find(tokens[0]);
       if(it == via2id.end()) {
         myVia = locateOrCreateVia(tokens[0]);
       }
@@ -1821,7 +1859,7 @@ void circuit::read_lef_macro(ifstream& is) {
     else if(tokens[0] == "CLASS") {
       get_next_n_tokens(is, tokens, 2, LEFCommentChar);
       assert(tokens[1] == LEFLineEndingChar);
-      myMacro->type = tokens[0];
+      myMacro->type = macro_class_from_str(tokens[0]);
     }
     else if(tokens[0] == "ORIGIN") {
       get_next_n_tokens(is, tokens, 3, LEFCommentChar);
@@ -2080,6 +2118,10 @@ void circuit::read_lef_macro_pin(ifstream& is, macro* myMacro) {
   }
   get_next_token(is, tokens[0], LEFCommentChar);
   assert(pinName == tokens[0]);
+  OPENDP_HASH_MAP< string, macro_pin >::iterator it =
+      myMacro->pins.find(pinName);
+  myPin.id =
+      (it != myMacro->pins.end()) ? it->second.id : myMacro->pins.size();
   myMacro->pins[pinName] = myPin;
   if(pinName == FFClkPortName) myMacro->isFlop = true;
   return;
@@ -2120,7 +2162,7 @@ void circuit::write_def(const string& output) {
     if(strncmp(line.c_str(), "COMPONENTS", 10) == 0) {
 
       // Write Components Sections
-      WriteDefComponents(in_def_name);
+      WriteDefComponents();
       do{ 
         getline(dot_in_def, line);
       } while( strncmp(line.c_str(), "END COMPONENTS", 14) != 0 );
@@ -50,6 +50,10 @@ using opendp::layer;
 using opendp::via;
 using opendp::group;
 using opendp::density_bin;
+using opendp::name_map;
+using opendp::name_view;
+using opendp::pin_key;
+using opendp::pin_key_map;
 
 using std::max;
 using std::min;
@@ -67,126 +71,117 @@ using std::string;
 using std::fixed;
 using std::numeric_limits;
 
-// requires full name, e.g., cell_instance/pin
-pin *circuit::locateOrCreatePin(const string &pinName) {
-  OPENDP_HASH_MAP< string, unsigned >::iterator it = pin2id.find(pinName);
-  if(it == pin2id.end()) {
+// IO pins by name
+pin *circuit::locateOrCreatePin(name_view pinName) {
+  pair< name_map::iterator, bool > it = pin2id.insert(pinName, pins.size());
+  if(it.second) {
     pin thePin;
-    thePin.name = pinName;
+    thePin.name = it.first->first;
     thePin.id = pins.size();
-    pin2id.insert(make_pair(pinName, thePin.id));
     pins.push_back(thePin);
-    return &pins[pins.size() - 1];
   }
-  else
-    return &pins[it->second];
+  return &pins[it.first->second];
 }
 
-cell *circuit::locateOrCreateCell(const string &cellName) {
-  OPENDP_HASH_MAP< string, unsigned >::iterator it = cell2id.find(cellName);
-  if(it == cell2id.end()) {
+// instance pins by cell and macro pin
+pin *circuit::locateOrCreatePin(unsigned owner, unsigned macro_pin_id) {
+  pin_key key = (pin_key)owner << 32 | macro_pin_id;
+  pin_key_map::iterator it = inst_pin2id.find(key);
+  if(it != inst_pin2id.end()) return &pins[it->second];
+  pin thePin;
+  thePin.id = pins.size();
+  inst_pin2id.insert_new(key, thePin.id);
+  pins.push_back(thePin);
+  return &pins[pins.size() - 1];
+}
+
+cell *circuit::locateOrCreateCell(name_view cellName) {
+  pair< name_map::iterator, bool > it = cell2id.insert(cellName, cells.size());
+  if(it.second) {
     cell theCell;
-    theCell.name = cellName;
     theCell.id = cells.size();
-    cell2id.insert(make_pair(theCell.name, cells.size()));
     cells.push_back(theCell);
-    return &cells[cells.size() - 1];
+    cell_names.push_back(it.first->first);
   }
-  else
-    return &cells[it->second];
+  return &cells[it.first->second];
+}
+
+name_view circuit::cell_name(const cell *theCell) {
+  if(theCell == &dummy_cell) return name_view("FIXED_DUMMY");
+  return cell_names[theCell->id];
 }
 
 macro *circuit::locateOrCreateMacro(const string &macroName) {
-  OPENDP_HASH_MAP< string, unsigned >::iterator it = macro2id.find(macroName);
-  if(it == macro2id.end()) {
+  pair< name_map::iterator, bool > it =
+      macro2id.insert(macroName, macros.size());
+  if(it.second) {
     macro theMacro;
     theMacro.name = macroName;
-    macro2id.insert(make_pair(theMacro.name, macros.size()));
     macros.push_back(theMacro);
-    return &macros[macros.size() - 1];
   }
-  else
-    return &macros[it->second];
+  return &macros[it.first->second];
 }
 
-net *circuit::locateOrCreateNet(const string &netName) {
-  OPENDP_HASH_MAP< string, unsigned >::iterator it = net2id.find(netName);
-  if(it == net2id.end()) {
+net *circuit::locateOrCreateNet(name_view netName) {
+  pair< name_map::iterator, bool > it = net2id.insert(netName, nets.size());
+  if(it.second) {
     net theNet;
-    theNet.name = netName;
-    net2id.insert(make_pair(theNet.name, nets.size()));
+    theNet.name = it.first->first;
     nets.push_back(theNet);
-    return &nets[nets.size() - 1];
   }
-  else
-    return &nets[it->second];
+  return &nets[it.first->second];
 }
 
 row *circuit::locateOrCreateRow(const string &rowName) {
-  OPENDP_HASH_MAP< string, unsigned >::iterator it = row2id.find(rowName);
-  if(it == row2id.end()) {
+  pair< name_map::iterator, bool > it = row2id.insert(rowName, prevrows.size());
+  if(it.second) {
     row theRow;
     theRow.name = rowName;
-    row2id.insert(make_pair(theRow.name, prevrows.size()));
     prevrows.push_back(theRow);
-    return &prevrows[prevrows.size() - 1];
   }
-  else
-    return &prevrows[it->second];
+  return &prevrows[it.first->second];
 }
 
 site *circuit::locateOrCreateSite(const string &siteName) {
-  OPENDP_HASH_MAP< string, unsigned >::iterator it = site2id.find(siteName);
-  if(it == site2id.end()) {
+  pair< name_map::iterator, bool > it = site2id.insert(siteName, sites.size());
+  if(it.second) {
     site theSite;
     theSite.name = siteName;
-    site2id.insert(make_pair(theSite.name, sites.size()));
     sites.push_back(theSite);
-    return &sites[sites.size() - 1];
   }
-  else
-    return &sites[it->second];
+  return &sites[it.first->second];
 }
 
 layer *circuit::locateOrCreateLayer(const string &layerName) {
-  OPENDP_HASH_MAP< string, unsigned >::iterator it = layer2id.find(layerName);
-  if(it == layer2id.end()) {
+  pair< name_map::iterator, bool > it =
+      layer2id.insert(layerName, layers.size());
+  if(it.second) {
     layer theLayer;
     theLayer.name = layerName;
-    layer2id.insert(make_pair(theLayer.name, layers.size()));
     layers.push_back(theLayer);
-    return &layers[layers.size() - 1];
   }
-  else
-    return &layers[it->second];
+  return &layers[it.first->second];
 }
 
 via *circuit::locateOrCreateVia(const string &viaName) {
-  OPENDP_HASH_MAP< string, unsigned >::iterator it = via2id.find(viaName);
-  if(it == via2id.end()) {
+  pair< name_map::iterator, bool > it = via2id.insert(viaName, vias.size());
+  if(it.second) {
     via theVia;
     theVia.name = viaName;
-    via2id.insert(make_pair(theVia.name, vias.size()));
     vias.push_back(theVia);
-    return &vias[vias.size() - 1];
   }
-  else
-    return &vias[it->second];
+  return &vias[it.first->second];
 }
 
 group *circuit::locateOrCreateGroup(const string &groupName) {
-  OPENDP_HASH_MAP< string, unsigned >::iterator it = group2id.find(groupName);
-  if(it == group2id.end()) {
+  pair< name_map::iterator, bool > it =
+      group2id.insert(groupName, groups.size());
+  if(it.second) {
     group theGroup;
     theGroup.name = groupName;
-
-    group2id.insert(make_pair(theGroup.name, groups.size()));
     groups.push_back(theGroup);
-
-    return &groups[groups.size() - 1];
   }
-  else
-    return &groups[it->second];
+  return &groups[it.first->second];
 }
 
 /* generic helper functions */
@@ -264,6 +259,38 @@ void opendp::get_next_n_tokens(ifstream &is, vector< string > &tokens,
   } while(!is.eof() && count < numTokens);
 }
 
+static const char *orient_names[] = {"N", "W", "S", "E", "FN", "FW", "FS", "FE"};
+
+opendp::orient opendp::orient_from_str(const string &str) {
+  for(int i = 0; i < 8; i++) {
+    if(str == orient_names[i]) return static_cast< orient >(i);
+  }
+  cerr << "orient_from_str:: unknown orientation " << str << endl;
+  exit(1);
+}
+
+const char *opendp::orient_str(orient theOrient) {
+  return orient_names[theOrient];
+}
+
+opendp::macro_class opendp::macro_class_from_str(const string &str) {
+  if(str == "CORE") return CLASS_CORE;
+  if(str.compare(0, 4, "CORE") == 0) return CLASS_CORE_OTHER;
+  if(str.compare(0, 5, "BLOCK") == 0) return CLASS_BLOCK;
+  if(str.compare(0, 3, "PAD") == 0) return CLASS_PAD;
+  if(str.compare(0, 5, "COVER") == 0) return CLASS_COVER;
+  if(str == "RING") return CLASS_RING;
+  if(str.compare(0, 6, "ENDCAP") == 0) return CLASS_ENDCAP;
+  return CLASS_UNKNOWN;
+}
+
+const char *opendp::macro_class_str(macro_class theClass) {
+  static const char *names[] = {"CORE",  "CORE (sub class)", "BLOCK",
+                                "PAD",   "COVER",            "RING",
+                                "ENDCAP", "UNKNOWN"};
+  return names[theClass];
+}
+
 void pin::print() {
   cout << "|=== BEGIN PIN ===|  " << endl;
   cout << "name:                " << name << endl;
@@ -280,7 +307,7 @@ void pin::print() {
 void macro::print() {
   cout << "|=== BEGIN MACRO ===|" << endl;
   cout << "name:                " << name << endl;
-  cout << "type:                " << type << endl;
+  cout << "type:                " << macro_class_str(type) << endl;
   cout << "(xOrig,yOrig):       " << xOrig << ", " << yOrig << endl;
   cout << "[width,height]:      " << width << ", " << height << endl;
   for(unsigned i = 0; i < sites.size(); ++i) {
@@ -295,13 +322,10 @@ void macro::print() {
 
 void cell::print() {
   cout << "|=== BEGIN CELL ===|" << endl;
-  cout << "name:               " << name << endl;
+  cout << "id:                 " << id << endl;
   cout << "type:               " << type << endl;
-  cout << "orient:             " << cellorient << endl;
+  cout << "orient:             " << orient_str(cellorient) << endl;
   cout << "isFixed?            " << (isFixed ? "true" : "false") << endl;
-  for(OPENDP_HASH_MAP< string, unsigned >::iterator it = ports.begin();
-      it != ports.end(); it++)
-    cout << "port: " << (*it).first << " - " << (*it).second << endl;
   cout << "(init_x,  init_y):  " << init_x_coord << ", " << init_y_coord
        << endl;
   cout << "(x_coord,y_coord):  " << x_coord << ", " << y_coord << endl;
@@ -325,7 +349,7 @@ void row::print() {
   cout << "(origX,origY):     " << origX << ", " << origY << endl;
   cout << "(stepX,stepY):     " << stepX << ", " << stepY << endl;
   cout << "numSites:          " << numSites << endl;
-  cout << "orientation:       " << siteorient << endl;
+  cout << "orientation:       " << orient_str(siteorient) << endl;
   cout << "|===  END  ROW ===|" << endl;
 }
 
@@ -44,6 +44,7 @@ using opendp::cell;
 using opendp::row;
 using opendp::pixel;
 using opendp::rect;
+using opendp::group;
 
 using std::cout;
 using std::endl;
@@ -53,6 +54,8 @@ using std::vector;
 using std::pair;
 using std::sort;
 using std::make_pair;
+using std::max;
+using std::min;
 
 double disp(cell* theCell) {
   return abs(theCell->init_x_coord - theCell->x_coord) +
@@ -95,6 +98,8 @@ bool SortDownOrder(cell* a, cell* b) {
 
 // SIMPLE PLACEMENT ( NOTICE // FUNCTION ORDER SHOULD BE FIXED )
 void circuit::simple_placement(CMeasure& measure) {
+  // bin densities size the search windows of the placement moves
+  calc_density_factor(4);
   if(groups.size() > 0) {
     // group_cell -> region assign
     group_cell_region_assign();
@@ -120,21 +125,64 @@ void circuit::simple_placement(CMeasure& measure) {
 
   // naive method placement ( Multi -> single )
   if(groups.size() > 0) {
-    group_cell_placement("init_coord");
+    if(engine == ENGINE_ABACUS)
+      abacus_group_cell_placement();
+    else
+      group_cell_placement(MODE_INIT_COORD);
     cout << " group_cell_placement done .. " << endl;
-    for(int i = 0; i < groups.size(); i++) {
-      group* theGroup = &groups[i];
+    vector< group* > group_list = groups_by_size();
+    // cells moved by each assignment pass of each refine round, per group
+    vector< vector< vector< int > > > group_moved(group_list.size());
+    vector< refine_stats > group_stats(group_list.size());
+#pragma omp parallel for num_threads(num_cpu) schedule(dynamic, 1)
+    for(int i = 0; i < group_list.size(); i++) {
+      group* theGroup = group_list[i];
       for(int j = 0; j < 3; j++) {
         int count_a = group_refine(theGroup);
-        int count_b = group_annealing(theGroup);
+        int count_b = group_annealing(theGroup, group_stats[i]);
+        group_moved[i].push_back(group_stats[i].pass_moved);
         if(count_a < 10 || count_b < 100) break;
       }
     }
+    // totals over the groups that ran each round
+    vector< vector< int > > round_total;
+    vector< int > round_groups;
+    int swap_attempts = 0;
+    int swap_accepted = 0;
+    for(int i = 0; i < group_moved.size(); i++) {
+      for(int j = 0; j < group_moved[i].size(); j++) {
+        if(j == round_total.size()) {
+          round_total.push_back(vector< int >());
+          round_groups.push_back(0);
+        }
+        vector< int >& total = round_total[j];
+        if(group_moved[i][j].size() > total.size())
+          total.resize(group_moved[i][j].size(), 0);
+        for(int k = 0; k < group_moved[i][j].size(); k++)
+          total[k] += group_moved[i][j][k];
+        round_groups[j]++;
+      }
+      swap_attempts += group_stats[i].swap_attempts;
+      swap_accepted += group_stats[i].swap_accepted;
+    }
+    for(int i = 0; i < round_total.size(); i++)
+      for(int j = 0; j < round_total[i].size(); j++)
+        cout << " group_annealing round " << i << " pass " << j << " : "
+             << round_total[i][j] << " cells moved in " << round_groups[i]
+             << " groups" << endl;
+    cout << " group_annealing swaps : " << swap_accepted << " / "
+         << swap_attempts << " accepted" << endl;
     measure.stop_clock("Group cell placement");
   }
-  non_group_cell_placement("init_coord");
+  if(engine == ENGINE_ABACUS)
+    abacus_non_group_cell_placement();
+  else
+    non_group_cell_placement(MODE_INIT_COORD);
   measure.stop_clock("non Group cell placement");
   cout << " non_group_cell_placement done .. " << endl;
+  non_group_annealing();
+  cout << " non_group_annealing done .. " << endl;
+  measure.stop_clock("non Group annealing");
   cout << " - - - - - - - - - - - - - - - - - - - - - - - - " << endl;
   return;
 }
@@ -150,7 +198,7 @@ void circuit::non_group_cell_pre_placement() {
       group* theGroup = &groups[j];
       for(int k = 0; k < theGroup->regions.size(); k++) {
         rect* theRect = &theGroup->regions[k];
-        if(check_overlap(theCell, theRect, "init_coord") == true) {
+        if(check_overlap(theCell, theRect, MODE_INIT_COORD) == true) {
           inGroup = true;
           target = theRect;
         }
@@ -158,7 +206,7 @@ void circuit::non_group_cell_pre_placement() {
     }
     if(inGroup == true) {
       pair< int, int > coord =
-          nearest_coord_to_rect_boundary(theCell, target, "init_coord");
+          nearest_coord_to_rect_boundary(theCell, target, MODE_INIT_COORD);
       if(map_move(theCell, coord.first, coord.second) == true)
         theCell->hold = true;
     }
@@ -166,9 +214,25 @@ void circuit::non_group_cell_pre_placement() {
   return;
 }
 
+// Fence groups own disjoint sites ( one free site map each ), so the group
+// phases run one group per thread. Groups are handed out largest first, so
+// a huge fence starts early instead of serializing the tail.
+vector< group* > circuit::groups_by_size() {
+  vector< group* > group_list;
+  group_list.reserve(groups.size());
+  for(int i = 0; i < groups.size(); i++) group_list.push_back(&groups[i]);
+  std::stable_sort(group_list.begin(), group_list.end(),
+                   [](group* a, group* b) {
+                     return a->siblings.size() > b->siblings.size();
+                   });
+  return group_list;
+}
+
 void circuit::group_cell_pre_placement() {
-  for(int i = 0; i < groups.size(); i++) {
-    group* theGroup = &groups[i];
+  vector< group* > group_list = groups_by_size();
+#pragma omp parallel for num_threads(num_cpu) schedule(dynamic, 1)
+  for(int i = 0; i < group_list.size(); i++) {
+    group* theGroup = group_list[i];
     for(int j = 0; j < theGroup->siblings.size(); j++) {
       cell* theCell = theGroup->siblings[j];
       if(theCell->isFixed == true || theCell->isPlaced == true) continue;
@@ -177,8 +241,9 @@ void circuit::group_cell_pre_placement() {
       rect* target;
       for(int k = 0; k < theGroup->regions.size(); k++) {
         rect* theRect = &theGroup->regions[k];
-        if(check_inside(theCell, theRect, "init_coord") == true) inGroup = true;
-        int temp_dist = dist_for_rect(theCell, theRect, "init_coord");
+        if(check_inside(theCell, theRect, MODE_INIT_COORD) == true)
+          inGroup = true;
+        int temp_dist = dist_for_rect(theCell, theRect, MODE_INIT_COORD);
         if(temp_dist < dist) {
           dist = temp_dist;
           target = theRect;
@@ -186,7 +251,7 @@ void circuit::group_cell_pre_placement() {
       }
       if(inGroup == false) {
         pair< int, int > coord =
-            nearest_coord_to_rect_boundary(theCell, target, "init_coord");
+            nearest_coord_to_rect_boundary(theCell, target, MODE_INIT_COORD);
         if(map_move(theCell, coord.first, coord.second) == true)
           theCell->hold = true;
       }
@@ -195,7 +260,13 @@ void circuit::group_cell_pre_placement() {
   return;
 }
 
-void circuit::non_group_cell_placement(string mode) {
+void circuit::non_group_cell_placement(coord_mode mode) {
+  // the stripe placement gives the same result for any number of threads,
+  // so it is used with -cpu 1 too
+  if(sub_regions.size() > 1) {
+    parallel_non_group_cell_placement(mode);
+    return;
+  }
   vector< cell* > cell_list;
   cell_list.reserve(cells.size());
 
@@ -223,77 +294,175 @@ void circuit::non_group_cell_placement(string mode) {
   return;
 }
 
-void circuit::group_cell_placement(string mode) {
+// non_group_cell_placement on num_cpu threads over the sub_regions stripes.
+// Each wave takes the next cell of every stripe and searches its position
+// inside the stripe, all against the same, read only, free site maps; the
+// positions are then painted. Stripes share no sites, so this is the serial
+// placement of one stripe after the other, whatever the number of threads.
+// A cell whose position in its stripe is further than the stripe border,
+// where the next stripe may hold a nearer one, waits for the next level,
+// where pairs of stripes are merged. The last level is the serial search
+// over the whole die.
+void circuit::parallel_non_group_cell_placement(coord_mode mode) {
+  int num_subs = sub_regions.size();
+  // cells by sub region at the first level, by stripe after that
+  vector< vector< cell* > > cell_lists(num_subs);
+  for(int i = 0; i < num_subs; i++) {
+    vector< cell* >& siblings = sub_regions[i].siblings;
+    for(int j = 0; j < siblings.size(); j++) {
+      cell* theCell = siblings[j];
+      if(theCell->isFixed || theCell->inGroup || theCell->isPlaced) continue;
+      cell_lists[i].push_back(theCell);
+    }
+  }
+
+  for(int span = 1; span < num_subs; span *= 2) {
+    // stripe i covers the sub regions [i * span, ( i + 1 ) * span)
+    int num_stripes = (num_subs + span - 1) / span;
+    vector< pair< int, int > > stripe(num_stripes);
+    for(int i = 0; i < num_stripes; i++) {
+      int last = min((i + 1) * span, num_subs) - 1;
+      stripe[i].first = (int)ceil(sub_regions[i * span].boundary.xLL / wsite);
+      stripe[i].second = (int)floor(sub_regions[last].boundary.xUR / wsite);
+      sort(cell_lists[i].begin(), cell_lists[i].end(), SortUpOrder);
+      // multi-row cells first, as in non_group_cell_placement
+      std::stable_partition(
+          cell_lists[i].begin(), cell_lists[i].end(),
+          [&](cell* theCell) { return macros[theCell->type].isMulti; });
+    }
+    // the outer stripes reach the die borders
+    stripe[0].first = INT_MIN;
+    stripe[num_stripes - 1].second = INT_MAX;
+
+    int num_waves = 0;
+    for(int i = 0; i < num_stripes; i++)
+      num_waves = max(num_waves, (int)cell_lists[i].size());
+
+    vector< vector< cell* > > next_lists((num_stripes + 1) / 2);
+    vector< pair< int, pair< int, int > > > found(num_stripes);
+    vector< int > border_dist(num_stripes);
+    for(int wave = 0; wave < num_waves; wave++) {
+#pragma omp parallel for num_threads(num_cpu) schedule(dynamic)
+      for(int i = 0; i < num_stripes; i++) {
+        if(wave >= cell_lists[i].size()) continue;
+        cell* theCell = cell_lists[i][wave];
+        pair< int, int > coord = mode_coord(theCell, mode);
+        int x = coord.first;
+        int y = coord.second;
+        border_dist[i] = INT_MAX;
+        if(i > 0) border_dist[i] = x - stripe[i].first * wsite;
+        if(i + 1 < num_stripes)
+          border_dist[i] = min(border_dist[i],
+                               (int)(stripe[i].second * wsite - x -
+                                     theCell->width));
+        border_dist[i] = max(border_dist[i], 0);
+        found[i] = nearest_position(theCell, x, y, stripe[i].first,
+                                    stripe[i].second, border_dist[i]);
+      }
+      for(int i = 0; i < num_stripes; i++) {
+        if(wave >= cell_lists[i].size()) continue;
+        cell* theCell = cell_lists[i][wave];
+        if(found[i].first == INT_MAX)
+          next_lists[i / 2].push_back(theCell);
+        else
+          paint_pixel(theCell, found[i].second.second, found[i].second.first);
+      }
+    }
+    cell_lists.swap(next_lists);
+  }
+
+  // what is left, over the whole die
+  vector< cell* >& cell_list = cell_lists[0];
+  sort(cell_list.begin(), cell_list.end(), SortUpOrder);
+  std::stable_partition(
+      cell_list.begin(), cell_list.end(),
+      [&](cell* theCell) { return macros[theCell->type].isMulti; });
+  for(int i = 0; i < cell_list.size(); i++) {
+    cell* theCell = cell_list[i];
+    if(map_move(theCell, mode) == false) shift_move(theCell, mode);
+  }
+  return;
+}
+
+void circuit::group_cell_placement(coord_mode mode) {
   group_cell_placement(mode, "INIT");
 }
 
-void circuit::group_cell_placement(string mode, string mode2) {
-  for(int i = 0; i < groups.size(); i++) {
-    bool single_pass = true;
-    bool multi_pass = true;
+void circuit::group_cell_placement(coord_mode mode, string mode2) {
+  vector< group* > group_list = groups_by_size();
+#pragma omp parallel for num_threads(num_cpu) schedule(dynamic, 1)
+  for(int i = 0; i < group_list.size(); i++) {
+    group_cell_placement(group_list[i], mode);
+  }
+  return;
+}
 
-    group* theGroup = &groups[i];
-    vector< cell* > cell_list;
-    cell_list.reserve(cells.size());
-    for(int j = 0; j < theGroup->siblings.size(); j++) {
-      cell* theCell = theGroup->siblings[j];
-      if(theCell->isFixed || theCell->isPlaced) continue;
-      cell_list.push_back(theCell);
+void circuit::group_cell_placement(group* theGroup, coord_mode mode) {
+  bool single_pass = true;
+  bool multi_pass = true;
+
+  vector< cell* > cell_list;
+  cell_list.reserve(theGroup->siblings.size());
+  for(int j = 0; j < theGroup->siblings.size(); j++) {
+    cell* theCell = theGroup->siblings[j];
+    if(theCell->isFixed || theCell->isPlaced) continue;
+    cell_list.push_back(theCell);
+  }
+  sort(cell_list.begin(), cell_list.end(), SortUpOrder);
+  // sort( cell_list.begin(), cell_list.end(), SortByDense);
+  // place multi-deck cells on each group region
+  for(int j = 0; j < cell_list.size(); j++) {
+    cell* theCell = cell_list[j];
+    if(theCell->isFixed || theCell->isPlaced) continue;
+    assert(theCell->inGroup == true);
+    macro* theMacro = &macros[theCell->type];
+    if(theMacro->isMulti == true) {
+      multi_pass = map_move(theCell, mode) || shift_move(theCell, mode);
+      if(multi_pass == false) {
+        cout << "map_move fail" << endl;
+        break;
+      }
     }
-    sort(cell_list.begin(), cell_list.end(), SortUpOrder);
-    // sort( cell_list.begin(), cell_list.end(), SortByDense);
-    // place multi-deck cells on each group region
+  }
+  // cout << "Group util : " << theGroup->util << endl;
+  if(multi_pass == true) {
+    //				cout << " Group : " << theGroup->name <<
+    //" multi-deck placement done - ";
+    // place single-deck cells on each group region
     for(int j = 0; j < cell_list.size(); j++) {
       cell* theCell = cell_list[j];
       if(theCell->isFixed || theCell->isPlaced) continue;
       assert(theCell->inGroup == true);
       macro* theMacro = &macros[theCell->type];
-      if(theMacro->isMulti == true) {
-        multi_pass = map_move(theCell, mode);
-        if(multi_pass == false) {
-          cout << "map_move fail" << endl;
+      if(theMacro->isMulti == false) {
+        single_pass = map_move(theCell, mode) || shift_move(theCell, mode);
+        if(single_pass == false) {
+          //						cout << "map_move fail" <<
+          //endl;
           break;
         }
       }
     }
-    // cout << "Group util : " << theGroup->util << endl;
-    if(multi_pass == true) {
-      //				cout << " Group : " << theGroup->name <<
-      //" multi-deck placement done - ";
-      // place single-deck cells on each group region
-      for(int j = 0; j < cell_list.size(); j++) {
-        cell* theCell = cell_list[j];
-        if(theCell->isFixed || theCell->isPlaced) continue;
-        assert(theCell->inGroup == true);
-        macro* theMacro = &macros[theCell->type];
-        if(theMacro->isMulti == false) {
-          single_pass = map_move(theCell, mode);
-          if(single_pass == false) {
-            //						cout << "map_move fail" <<
-            //endl;
-            break;
-          }
-        }
-      }
+  }
+  //			if( single_pass == true )
+  //				cout << "single-deck placement done" << endl;
+
+  // a cell map_move can't place gets a shift_move first, so the whole
+  // group is only re-placed when that leaves a cell unplaced too
+  if(single_pass == false || multi_pass == false) {
+    // Erase group cells
+    for(int j = 0; j < theGroup->siblings.size(); j++) {
+      cell* theCell = theGroup->siblings[j];
+      erase_pixel(theCell);
     }
-    //			if( single_pass == true )
-    //				cout << "single-deck placement done" << endl;
-
-    if(single_pass == false || multi_pass == false) {
-      // Erase group cells
-      for(int j = 0; j < theGroup->siblings.size(); j++) {
-        cell* theCell = theGroup->siblings[j];
-        erase_pixel(theCell);
-      }
-      //				cout << "erase done" << endl;
+    //				cout << "erase done" << endl;
 
-      // determine brick placement by utilization
-      if(theGroup->util > 0.95) {
-        brick_placement_1(theGroup);
-      }
-      else {
-        brick_placement_2(theGroup);
-      }
+    // determine brick placement by utilization
+    if(theGroup->util > 0.95) {
+      brick_placement_1(theGroup);
+    }
+    else {
+      brick_placement_2(theGroup);
     }
   }
   return;
@@ -346,7 +515,7 @@ void circuit::brick_placement_1(group* theGroup) {
     bool valid = map_move(theCell, x_tar, y_tar);
     if(valid == false) {
       cout << "== WARNING !! ==" << endl;
-      cout << " Can't place single ( brick place 1 ) " << theCell->name << endl;
+      cout << " Can't place single ( brick place 1 ) " << cell_name(theCell) << endl;
     }
   }
   return;
@@ -398,7 +567,7 @@ void circuit::brick_placement_2(group* theGroup) {
     bool valid = map_move(theCell, x_tar, y_tar);
     if(valid == false) {
       cout << "== WARNING !! ==" << endl;
-      cout << " Can't place single ( brick place 2 ) " << theCell->name << endl;
+      cout << " Can't place single ( brick place 2 ) " << cell_name(theCell) << endl;
     }
   }
 
@@ -426,40 +595,44 @@ int circuit::group_refine(group* theGroup) {
     cell* theCell = sort_by_disp[i].second;
     if(theCell->hold == true) continue;
 
-    if(refine_move(theCell, "init_coord") == true) count++;
+    if(refine_move(theCell, MODE_INIT_COORD) == true) count++;
   }
   // cout << " Group refine : " << count << endl;
   return count;
 }
 
-int circuit::group_annealing(group* theGroup) {
-  srand(777);
-  // srand(time(NULL));
-  int count = 0;
-
-  for(int i = 0; i < 1000 * theGroup->siblings.size(); i++) {
-    cell* cellA = theGroup->siblings[rand() % theGroup->siblings.size()];
-    cell* cellB = theGroup->siblings[rand() % theGroup->siblings.size()];
-
-    if(cellA->hold == true || cellB->hold == true) continue;
-
-    if(swap_cell(cellA, cellB) == true) count++;
-  }
+// windowed assignment of interchangeable cells ( reassign.cpp ) in place of
+// random swap_cell probes
+int circuit::group_annealing(group* theGroup, refine_stats& stats) {
+  int count = assignment_refine(theGroup->siblings, stats.pass_moved);
+  count += 2 * swap_refine(theGroup->siblings, stats);
   // cout << " swap cell count : " << count << endl;
   return count;
 }
 
 int circuit::non_group_annealing() {
-  srand(777);
-  int count = 0;
-  for(int i = 0; i < 100 * cells.size(); i++) {
-    cell* cellA = &cells[rand() % cells.size()];
-    cell* cellB = &cells[rand() % cells.size()];
-    if(cellA->hold == true || cellB->hold == true) continue;
-
-    if(swap_cell(cellA, cellB) == true) count++;
+  vector< cell* > cell_list;
+  cell_list.reserve(cells.size());
+  for(int i = 0; i < cells.size(); i++) {
+    if(cells[i].inGroup) continue;
+    cell_list.push_back(&cells[i]);
+  }
+  refine_stats stats;
+  int count = assignment_refine(cell_list, stats.pass_moved);
+  if(hpwl_weight > 0.0) init_net_boxes();
+  long long start_hpwl = cached_hpwl;
+  count += 2 * swap_refine(cell_list, stats);
+  for(int i = 0; i < stats.pass_moved.size(); i++)
+    cout << " non_group_annealing pass " << i << " : " << stats.pass_moved[i]
+         << " / " << cell_list.size() << " cells moved" << endl;
+  cout << " non_group_annealing swaps : " << stats.swap_accepted << " / "
+       << stats.swap_attempts << " accepted" << endl;
+  if(net_boxes.empty() == false) {
+    cout << " non_group_annealing HPWL : "
+         << start_hpwl / static_cast< double >(DEFdist2Microns) << " -> "
+         << cached_hpwl / static_cast< double >(DEFdist2Microns) << endl;
+    clear_net_boxes();
   }
-  // cout << " swap cell count : " << count << endl;
   return count;
 }
 
@@ -481,7 +654,7 @@ int circuit::non_group_refine() {
   for(int i = 0; i < sort_by_disp.size() / 50; i++) {
     cell* theCell = sort_by_disp[i].second;
     if(theCell->hold == true) continue;
-    if(refine_move(theCell, "init_coord") == true) count++;
+    if(refine_move(theCell, MODE_INIT_COORD) == true) count++;
   }
   // cout << " nonGroup refine : " << count << endl;
   return count;
@@ -0,0 +1,369 @@
+/////////////////////////////////////////////////////////////////////////////
+// Authors: SangGi Do(sanggido@unist.ac.kr), Mingyu Woo(mwoo@eng.ucsd.edu)
+//          (respective Ph.D. advisors: Seokhyeong Kang, Andrew B. Kahng)
+//
+//          Original parsing structure was made by Myung-Chul Kim (IBM).
+//
+// BSD 3-Clause License
+//
+// Copyright (c) 2018, SangGi Do and Mingyu Woo
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// * Neither the name of the copyright holder nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "circuit.h"
+
+using opendp::circuit;
+using opendp::cell;
+using opendp::macro;
+
+using std::max;
+using std::min;
+using std::abs;
+using std::vector;
+using std::pair;
+using std::make_pair;
+
+// Cells with the same footprint ( width, height, edge types and top power )
+// can take each other's positions without breaking legality, so inside a
+// window the best way to seat them on the positions they already occupy is
+// a min-cost bipartite assignment on the displacement. The windows are
+// solved with the Hungarian method, ASSIGN_PASSES times with the window
+// grid shifted by a random offset so cells can cross the window borders.
+// An assignment only permutes the positions of its own cells, so the
+// windows of a pass are solved in parallel, and the offsets come from a
+// counter based generator on ( seed, pass ): the result does not depend on
+// the number of threads.
+
+#define ASSIGN_WINDOW 10 /* window side, in rows */
+#define ASSIGN_MAX 32    /* largest assignment solved at once */
+#define ASSIGN_PASSES 2
+#define SWAP_BIN 10        /* swap candidate bin side, in rows */
+#define SWAP_CANDIDATES 32 /* pairs evaluated per cell */
+
+namespace {
+
+// splitmix64 finalizer over the counters, no state
+unsigned long long counter_rng(unsigned long long seed, unsigned long long a,
+                               unsigned long long b) {
+  unsigned long long z = seed * 0x9E3779B97F4A7C15ULL + a;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL + b;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+// Hungarian method with potentials on the square matrix cost[i * n + j]
+// ( cell i, slot j ). Returns the slot of each cell
+vector< int > min_cost_assignment(const vector< double >& cost, int n) {
+  const double inf = std::numeric_limits< double >::max();
+  // 1 based, slot 0 is the virtual root of each augmenting path
+  vector< double > u(n + 1, 0.0), v(n + 1, 0.0), min_v(n + 1);
+  vector< int > cell_of(n + 1, 0), way(n + 1, 0);
+  vector< bool > used(n + 1);
+  for(int i = 1; i <= n; i++) {
+    cell_of[0] = i;
+    int j0 = 0;
+    std::fill(min_v.begin(), min_v.end(), inf);
+    std::fill(used.begin(), used.end(), false);
+    do {
+      used[j0] = true;
+      int i0 = cell_of[j0];
+      double delta = inf;
+      int j1 = 0;
+      for(int j = 1; j <= n; j++) {
+        if(used[j]) continue;
+        double cur = cost[(i0 - 1) * n + (j - 1)] - u[i0] - v[j];
+        if(cur < min_v[j]) {
+          min_v[j] = cur;
+          way[j] = j0;
+        }
+        if(min_v[j] < delta) {
+          delta = min_v[j];
+          j1 = j;
+        }
+      }
+      for(int j = 0; j <= n; j++) {
+        if(used[j]) {
+          u[cell_of[j]] += delta;
+          v[j] -= delta;
+        }
+        else
+          min_v[j] -= delta;
+      }
+      j0 = j1;
+    } while(cell_of[j0] != 0);
+    do {
+      int j1 = way[j0];
+      cell_of[j0] = cell_of[j1];
+      j0 = j1;
+    } while(j0 != 0);
+  }
+  vector< int > slot_of(n);
+  for(int j = 1; j <= n; j++) slot_of[cell_of[j] - 1] = j - 1;
+  return slot_of;
+}
+
+}  // namespace
+
+// reseats the cells of one window footprint class, returns how many moved
+int circuit::assignment_solve(vector< cell* >& cell_list) {
+  int n = cell_list.size();
+  if(n < 2) return 0;
+
+  vector< pair< int, int > > slots(n);
+  vector< double > cost(n * n);
+  double curr_cost = 0.0;
+  for(int j = 0; j < n; j++)
+    slots[j] = make_pair(cell_list[j]->x_pos, cell_list[j]->y_pos);
+  for(int i = 0; i < n; i++) {
+    cell* theCell = cell_list[i];
+    for(int j = 0; j < n; j++) {
+      cost[i * n + j] =
+          abs(theCell->init_x_coord - slots[j].first * wsite) +
+          abs(theCell->init_y_coord - slots[j].second * rowHeight);
+    }
+    curr_cost += cost[i * n + i];
+  }
+
+  // every cell already on its closest slot is optimal as it is
+  bool optimal = true;
+  for(int i = 0; i < n && optimal; i++) {
+    for(int j = 0; j < n; j++) {
+      if(cost[i * n + j] < cost[i * n + i]) {
+        optimal = false;
+        break;
+      }
+    }
+  }
+  if(optimal) return 0;
+
+  vector< int > slot_of = min_cost_assignment(cost, n);
+  double new_cost = 0.0;
+  for(int i = 0; i < n; i++) new_cost += cost[i * n + slot_of[i]];
+  // ties keep the current placement
+  if(new_cost >= curr_cost - 1e-6) return 0;
+
+  // the free site map rows are shared with the other windows
+  int count = 0;
+#pragma omp critical(assignment_commit)
+  {
+    for(int i = 0; i < n; i++) {
+      if(slot_of[i] == i) continue;
+      erase_pixel(cell_list[i]);
+      count++;
+    }
+    for(int i = 0; i < n; i++) {
+      if(slot_of[i] == i) continue;
+      paint_pixel(cell_list[i], slots[slot_of[i]].first,
+                  slots[slot_of[i]].second);
+    }
+  }
+  return count;
+}
+
+// width, height, edge types and top power, packed in that order into one
+// key: cells of the same class can take each other's positions
+unsigned long long circuit::footprint_class(cell* theCell) {
+  macro* theMacro = &macros[theCell->type];
+  unsigned long long key = (unsigned)ceil(theCell->width / wsite);
+  key = (key << 16) | (unsigned)ceil(theCell->height / rowHeight);
+  key = (key << 6) | theMacro->edgetypeLeft;
+  key = (key << 6) | theMacro->edgetypeRight;
+  key = (key << 4) | theMacro->top_power;
+  return key;
+}
+
+// pass_moved gets the number of cells moved by each pass
+int circuit::assignment_refine(vector< cell* >& cell_list,
+                               vector< int >& pass_moved) {
+  // footprint class of each movable cell
+  vector< pair< unsigned long long, cell* > > keyed;
+  keyed.reserve(cell_list.size());
+  for(int i = 0; i < cell_list.size(); i++) {
+    cell* theCell = cell_list[i];
+    if(theCell->isFixed || theCell->hold || !theCell->isPlaced) continue;
+    keyed.push_back(make_pair(footprint_class(theCell), theCell));
+  }
+
+  int window_x = (int)ceil(ASSIGN_WINDOW * rowHeight / wsite);
+  int window_y = ASSIGN_WINDOW;
+  int count = 0;
+  pass_moved.assign(ASSIGN_PASSES, 0);
+  for(int pass = 0; pass < ASSIGN_PASSES; pass++) {
+    int shift_x = counter_rng(seed, pass, 0) % window_x;
+    int shift_y = counter_rng(seed, pass, 1) % window_y;
+    // class, window row, window column, then x inside the window
+    vector< pair< pair< int, int >, int > > order(keyed.size());
+    for(int i = 0; i < keyed.size(); i++) {
+      cell* theCell = keyed[i].second;
+      order[i].first.first = (theCell->y_pos + shift_y) / window_y;
+      order[i].first.second = (theCell->x_pos + shift_x) / window_x;
+      order[i].second = i;
+    }
+    sort(order.begin(), order.end(),
+         [&](const pair< pair< int, int >, int >& a,
+             const pair< pair< int, int >, int >& b) {
+           unsigned long long key_a = keyed[a.second].first;
+           unsigned long long key_b = keyed[b.second].first;
+           if(key_a != key_b) return key_a < key_b;
+           if(a.first != b.first) return a.first < b.first;
+           cell* cellA = keyed[a.second].second;
+           cell* cellB = keyed[b.second].second;
+           if(cellA->x_pos != cellB->x_pos) return cellA->x_pos < cellB->x_pos;
+           return cellA->id < cellB->id;
+         });
+
+    // windows as [begin, end) of order
+    vector< pair< int, int > > windows;
+    int begin = 0;
+    for(int i = 0; i < order.size(); i++) {
+      bool last = (i + 1 == order.size() ||
+                   keyed[order[i + 1].second].first !=
+                       keyed[order[i].second].first ||
+                   order[i + 1].first != order[i].first);
+      if(last || i + 1 - begin == ASSIGN_MAX) {
+        windows.push_back(make_pair(begin, i + 1));
+        begin = i + 1;
+      }
+    }
+
+    int moved = 0;
+#pragma omp parallel for num_threads(num_cpu) schedule(dynamic, 16) \
+    reduction(+ : moved)
+    for(int i = 0; i < windows.size(); i++) {
+      vector< cell* > window;
+      for(int j = windows[i].first; j < windows[i].second; j++)
+        window.push_back(keyed[order[j].second].second);
+      moved += assignment_solve(window);
+    }
+    pass_moved[pass] = moved;
+    count += moved;
+  }
+  return count;
+}
+
+// Swaps the windows cannot see: a cell placed far from its global placement
+// position against a cell of its footprint class sitting near that position.
+// Each class keeps its positions in SWAP_BIN x SWAP_BIN rows bins; cells are
+// taken by decreasing displacement, and up to SWAP_CANDIDATES positions in
+// the bins around the cell's target are evaluated, the best improving swap
+// is made. Swaps only exchange positions, so the bins never change.
+int circuit::swap_refine(vector< cell* >& cell_list, refine_stats& stats) {
+  std::map< unsigned long long, vector< cell* > > classes;
+  for(int i = 0; i < cell_list.size(); i++) {
+    cell* theCell = cell_list[i];
+    if(theCell->isFixed || theCell->hold || !theCell->isPlaced) continue;
+    classes[footprint_class(theCell)].push_back(theCell);
+  }
+
+  int bin_x = (int)ceil(SWAP_BIN * rowHeight / wsite);
+  int bin_y = SWAP_BIN;
+  // the net boxes are only kept by the serial phases
+  bool use_hpwl = (hpwl_weight > 0.0 && net_boxes.empty() == false);
+  auto dist = [&](cell* theCell, const pair< int, int >& pos) {
+    return abs(theCell->init_x_coord - pos.first * wsite) +
+           abs(theCell->init_y_coord - pos.second * rowHeight);
+  };
+
+  int count = 0;
+  for(auto& theClass : classes) {
+    vector< cell* >& members = theClass.second;
+    int n = members.size();
+    if(n < 2) continue;
+
+    // position p starts as the one of members[p]
+    vector< pair< int, int > > slots(n);
+    vector< int > slot_cell(n);
+    vector< int > cell_slot(n);
+    std::map< pair< int, int >, vector< int > > bins;
+    for(int i = 0; i < n; i++) {
+      slots[i] = make_pair(members[i]->x_pos, members[i]->y_pos);
+      slot_cell[i] = i;
+      cell_slot[i] = i;
+      bins[make_pair(slots[i].second / bin_y, slots[i].first / bin_x)]
+          .push_back(i);
+    }
+
+    vector< pair< double, int > > order(n);
+    for(int i = 0; i < n; i++)
+      order[i] = make_pair(-dist(members[i], slots[i]), i);
+    sort(order.begin(), order.end());
+
+    for(int k = 0; k < n; k++) {
+      int a = order[k].second;
+      cell* cellA = members[a];
+      double dist_a = dist(cellA, slots[cell_slot[a]]);
+      if(dist_a == 0.0) break;
+      int target_x = (int)floor(cellA->init_x_coord / wsite) / bin_x;
+      int target_y = (int)floor(cellA->init_y_coord / rowHeight) / bin_y;
+
+      double best_benefit = 0.0;
+      int best_slot = -1;
+      int tried = 0;
+      for(int dy = -1; dy <= 1 && tried < SWAP_CANDIDATES; dy++) {
+        for(int dx = -1; dx <= 1 && tried < SWAP_CANDIDATES; dx++) {
+          auto it = bins.find(make_pair(target_y + dy, target_x + dx));
+          if(it == bins.end()) continue;
+          vector< int >& theBin = it->second;
+          for(int j = 0; j < theBin.size() && tried < SWAP_CANDIDATES; j++) {
+            int s = theBin[j];
+            int b = slot_cell[s];
+            if(b == a) continue;
+            tried++;
+            cell* cellB = members[b];
+            const pair< int, int >& pos_a = slots[cell_slot[a]];
+            double benefit = dist(cellA, slots[s]) + dist(cellB, pos_a) -
+                             dist_a - dist(cellB, slots[s]);
+            if(use_hpwl) benefit += hpwl_weight * delta_hpwl(cellA, cellB);
+            if(benefit < best_benefit) {
+              best_benefit = benefit;
+              best_slot = s;
+            }
+          }
+        }
+      }
+      stats.swap_attempts += tried;
+      if(best_slot < 0) continue;
+
+      int b = slot_cell[best_slot];
+      int slot_a = cell_slot[a];
+      cell* cellB = members[b];
+      erase_pixel(cellA);
+      erase_pixel(cellB);
+      paint_pixel(cellA, slots[best_slot].first, slots[best_slot].second);
+      paint_pixel(cellB, slots[slot_a].first, slots[slot_a].second);
+      slot_cell[best_slot] = a;
+      slot_cell[slot_a] = b;
+      cell_slot[a] = best_slot;
+      cell_slot[b] = slot_a;
+      stats.swap_accepted++;
+      count++;
+    }
+  }
+  return count;
+}
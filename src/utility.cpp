@@ -43,7 +43,10 @@ using opendp::circuit;
 using opendp::cell;
 using opendp::row;
 using opendp::pixel;
+using opendp::free_site_map;
+using opendp::start_row_mask;
 using opendp::rect;
+using opendp::placement_metrics;
 
 using std::max;
 using std::min;
@@ -78,121 +81,139 @@ void circuit::power_mapping() {
   return;
 }
 
-void circuit::evaluation() {
-  double avg_displacement = 0;
-  double sum_displacement = 0;
-  double max_displacement = 0;
-  int count_displacement = 0;
-
-  cell* maxCell = NULL;
-
+// called after power_mapping; one mask per ( row span, top power ) of the
+// movable cells
+void circuit::init_start_rows() {
+  int max_span = 1;
   for(int i = 0; i < cells.size(); i++) {
-    cell* theCell = &cells[i];
-    double displacement = abs(theCell->init_x_coord - theCell->x_coord) +
-                          abs(theCell->init_y_coord - theCell->y_coord);
-    sum_displacement += displacement;
-    if(displacement > max_displacement) {
-      max_displacement = displacement;
-      maxCell = theCell;
+    if(cells[i].isFixed) continue;
+    max_span = max(max_span, (int)ceil(cells[i].height / rowHeight));
+  }
+  int row_num = rows.size();
+  start_rows.assign((max_span + 1) * 2, start_row_mask());
+  for(int span = 1; span <= max_span; span++) {
+    for(int p = 0; p < 2; p++) {
+      start_row_mask* theMask = &start_rows[span * 2 + p];
+      theMask->legal.assign(row_num, 0);
+      for(int y = 0; y < row_num; y++) {
+        // IF y is out of border
+        if(y + span > (die.yUR / rowHeight)) continue;
+        // even number multi-deck cell -> check top power
+        if(span % 2 == 0 && rows[y].top_power == p) continue;
+        theMask->legal[y] = 1;
+      }
+      theMask->next_legal.assign(row_num, -1);
+      theMask->prev_legal.assign(row_num, -1);
+      for(int y = 0, last = -1; y < row_num; y++) {
+        if(theMask->legal[y]) last = y;
+        theMask->prev_legal[y] = last;
+      }
+      for(int y = row_num - 1, last = -1; y >= 0; y--) {
+        if(theMask->legal[y]) last = y;
+        theMask->next_legal[y] = last;
+      }
     }
-    count_displacement++;
   }
-  avg_displacement = sum_displacement / count_displacement;
+  return;
+}
 
-  double max_util = 0.0;
-  for(int i = 0; i < groups.size(); i++) {
-    group* theGroup = &groups[i];
-    if(max_util < theGroup->util) max_util = theGroup->util;
-  }
+const start_row_mask* circuit::cell_start_rows(cell* theCell) {
+  macro* theMacro = &macros[theCell->type];
+  int y_step = (int)ceil(theCell->height / rowHeight);
+  return &start_rows[y_step * 2 + theMacro->top_power];
+}
+
+void circuit::evaluation() {
+  placement_metrics metrics = measure_metrics();
+  double avg_displacement = metrics.sum_disp / metrics.num_cells;
 
   cout << " - - - - - EVALUATION - - - - - " << endl;
   cout << " AVG_displacement : " << avg_displacement << endl;
-  cout << " SUM_displacement : " << sum_displacement << endl;
-  cout << " MAX_displacement : " << max_displacement << endl;
+  cout << " SUM_displacement : " << metrics.sum_disp << endl;
+  cout << " MAX_displacement : " << metrics.max_disp << endl;
   cout << " - - - - - - - - - - - - - - - - " << endl;
-  cout << " GP HPWL          : " << HPWL("INIT") << endl;
-  cout << " HPWL             : " << HPWL("") << endl;
-  cout << " avg_Disp_site    : " << Disp() / cells.size() / wsite << endl;
-  cout << " avg_Disp_row     : " << Disp() / cells.size() / rowHeight << endl;
+  cout << " GP HPWL          : " << metrics.init_hpwl << endl;
+  cout << " HPWL             : " << metrics.hpwl << endl;
+  cout << " avg_Disp_site    : " << metrics.placed_disp / cells.size() / wsite
+       << endl;
+  cout << " avg_Disp_row     : "
+       << metrics.placed_disp / cells.size() / rowHeight << endl;
   cout << " delta_HPWL       : "
-       << (HPWL("") - HPWL("INIT")) / HPWL("INIT") * 100 << endl;
+       << (metrics.hpwl - metrics.init_hpwl) / metrics.init_hpwl * 100
+       << endl;
+  for(int i = 0; i < groups.size(); i++) {
+    if(metrics.group_cells[i] == 0) continue;
+    cout << " group " << groups[i].name << " : " << metrics.group_cells[i]
+         << " cells, avg_Disp_site "
+         << metrics.group_sum_disp[i] / metrics.group_cells[i] / wsite
+         << ", max_Disp_site " << metrics.group_max_disp[i] / wsite << endl;
+  }
 
   return;
 }
 
-double circuit::Disp() {
-  double result = 0.0;
-  for(int i = 0; i < cells.size(); i++) {
-    cell* theCell = &cells[i];
-    if(theCell->x_coord == 0 && theCell->y_coord == 0) continue;
-    result += abs(theCell->init_x_coord - theCell->x_coord) +
-              abs(theCell->init_y_coord - theCell->y_coord);
-  }
-  return result;
-}
-
-double circuit::HPWL(string mode) {
-  double hpwl = 0;
-
-  double x_coord = 0;
-  double y_coord = 0;
-
-  for(int i = 0; i < nets.size(); i++) {
-    rect box;
-    net* theNet = &nets[i];
-    // cout << " net name : " << theNet->name << endl;
-    pin* source = &pins[theNet->source];
-
-    if(source->type == NONPIO_PIN) {
-      cell* theCell = &cells[source->owner];
-      if(mode == "INIT") {
-        x_coord = theCell->init_x_coord;
-        y_coord = theCell->init_y_coord;
+// The cells are cut in fixed size chunks, measured in parallel and summed
+// up in chunk order, so the numbers don't depend on num_cpu. The HPWLs are
+// taken over the netlist the same way ( total_hpwl ).
+placement_metrics circuit::measure_metrics() {
+  const int chunk = 4096;
+  placement_metrics metrics;
+  metrics.num_cells = cells.size();
+  metrics.group_cells.assign(groups.size(), 0);
+  metrics.group_sum_disp.assign(groups.size(), 0.0);
+  metrics.group_max_disp.assign(groups.size(), 0.0);
+
+  int num_chunks = (cells.size() + chunk - 1) / chunk;
+  vector< placement_metrics > parts(num_chunks);
+#pragma omp parallel for num_threads(num_cpu) schedule(dynamic)
+  for(int c = 0; c < num_chunks; c++) {
+    placement_metrics& part = parts[c];
+    part.group_cells.assign(groups.size(), 0);
+    part.group_sum_disp.assign(groups.size(), 0.0);
+    part.group_max_disp.assign(groups.size(), 0.0);
+    int end = min((int)cells.size(), (c + 1) * chunk);
+    for(int i = c * chunk; i < end; i++) {
+      cell* theCell = &cells[i];
+      double displacement = abs(theCell->init_x_coord - theCell->x_coord) +
+                            abs(theCell->init_y_coord - theCell->y_coord);
+      part.sum_disp += displacement;
+      if(displacement > part.max_disp) {
+        part.max_disp = displacement;
+        part.max_cell = theCell;
       }
-      else {
-        x_coord = theCell->x_coord;
-        y_coord = theCell->y_coord;
+      if(theCell->x_coord != 0 || theCell->y_coord != 0)
+        part.placed_disp += displacement;
+      if(theCell->inGroup) {
+        part.group_cells[theCell->group]++;
+        part.group_sum_disp[theCell->group] += displacement;
+        part.group_max_disp[theCell->group] =
+            max(part.group_max_disp[theCell->group], displacement);
       }
-      box.xLL = box.xUR = x_coord + source->x_offset * DEFdist2Microns;
-      box.yLL = box.yUR = y_coord + source->y_offset * DEFdist2Microns;
     }
-    else {
-      box.xLL = box.xUR = source->x_coord;
-      box.yLL = box.yUR = source->y_coord;
+  }
+
+  for(int c = 0; c < num_chunks; c++) {
+    metrics.sum_disp += parts[c].sum_disp;
+    metrics.placed_disp += parts[c].placed_disp;
+    if(parts[c].max_disp > metrics.max_disp) {
+      metrics.max_disp = parts[c].max_disp;
+      metrics.max_cell = parts[c].max_cell;
     }
-      
-    for(int j = 0; j < theNet->sinks.size(); j++) {
-      pin* sink = &pins[theNet->sinks[j]];
-      // cout << " sink name : " << sink->name << endl;
-      if(sink->type == NONPIO_PIN) {
-        cell* theCell = &cells[sink->owner];
-        if(mode == "INIT") {
-          x_coord = theCell->init_x_coord;
-          y_coord = theCell->init_y_coord;
-        }
-        else {
-          x_coord = theCell->x_coord;
-          y_coord = theCell->y_coord;
-        }
-        box.xLL = min(box.xLL, x_coord + sink->x_offset * DEFdist2Microns);
-        box.xUR = max(box.xUR, x_coord + sink->x_offset * DEFdist2Microns);
-        box.yLL = min(box.yLL, y_coord + sink->y_offset * DEFdist2Microns);
-        box.yUR = max(box.yUR, y_coord + sink->y_offset * DEFdist2Microns);
-      }
-      else {
-        box.xLL = min(box.xLL, sink->x_coord);
-        box.xUR = max(box.xUR, sink->x_coord);
-        box.yLL = min(box.yLL, sink->y_coord);
-        box.yUR = max(box.yUR, sink->y_coord);
-      }
+    for(int j = 0; j < groups.size(); j++) {
+      metrics.group_cells[j] += parts[c].group_cells[j];
+      metrics.group_sum_disp[j] += parts[c].group_sum_disp[j];
+      metrics.group_max_disp[j] =
+          max(metrics.group_max_disp[j], parts[c].group_max_disp[j]);
     }
-    
-
-    double box_boundary = (box.xUR - box.xLL + box.yUR - box.yLL);
-
-    hpwl += box_boundary;
   }
-  return hpwl / static_cast< double >(DEFdist2Microns);
+
+  vector< int > x, y;
+  double dbu = static_cast< double >(DEFdist2Microns);
+  cell_coords(true, x, y);
+  metrics.init_hpwl = total_hpwl(x, y) / dbu;
+  cell_coords(false, x, y);
+  metrics.hpwl = total_hpwl(x, y) / dbu;
+  return metrics;
 }
 
 double circuit::calc_density_factor(double unit) {
@@ -276,7 +297,7 @@ double circuit::calc_density_factor(double unit) {
 
         if(theCell->inGroup)
           bins[binId].density_limit = max(
-              bins[binId].density_limit, groups[group2id[theCell->group]].util);
+              bins[binId].density_limit, groups[theCell->group].util);
 
         /* get intersection */
         double lx = max(bins[binId].lx, (double)theCell->init_x_coord);
@@ -352,31 +373,16 @@ void circuit::group_analyze() {
 
 pair< int, int > circuit::nearest_coord_to_rect_boundary(cell* theCell,
                                                          rect* theRect,
-                                                         string mode) {
-  int x = INT_MAX;
-  int y = INT_MAX;
+                                                         coord_mode mode) {
+  pair< int, int > coord = mode_coord(theCell, mode);
+  int x = coord.first;
+  int y = coord.second;
   int size_x = (int)floor(theCell->width / wsite + 0.5);
   int size_y = (int)floor(theCell->height / rowHeight + 0.5);
-  if(mode == "init_coord") {
-    x = theCell->init_x_coord;
-    y = theCell->init_y_coord;
-  }
-  else if(mode == "coord") {
-    x = theCell->x_coord;
-    y = theCell->y_coord;
-  }
-  else if(mode == "pos") {
-    x = theCell->x_pos * wsite;
-    y = theCell->y_pos * rowHeight;
-  }
-  else {
-    cerr << "circuit::nearest_coord_to_rect_boundary == invalid mode!" << endl;
-    exit(2);
-  }
   int temp_x = x;
   int temp_y = y;
 
-  if(check_overlap(theCell, theRect, "init_coord") == true) {
+  if(check_overlap(theCell, theRect, MODE_INIT_COORD) == true) {
     int dist_x = 0;
     int dist_y = 0;
     if(abs(x - theRect->xLL + theCell->width) > abs(theRect->xUR - x)) {
@@ -424,25 +430,10 @@ pair< int, int > circuit::nearest_coord_to_rect_boundary(cell* theCell,
   return make_pair(temp_x, temp_y);
 }
 
-int circuit::dist_for_rect(cell* theCell, rect* theRect, string mode) {
-  int x = INT_MAX;
-  int y = INT_MAX;
-  if(mode == "init_coord") {
-    x = theCell->init_x_coord;
-    y = theCell->init_y_coord;
-  }
-  else if(mode == "coord") {
-    x = theCell->x_coord;
-    y = theCell->y_coord;
-  }
-  else if(mode == "pos") {
-    x = theCell->x_pos * wsite;
-    y = theCell->y_pos * rowHeight;
-  }
-  else {
-    cerr << "circuit::dist_for_rect == invalid mode!" << endl;
-    exit(2);
-  }
+int circuit::dist_for_rect(cell* theCell, rect* theRect, coord_mode mode) {
+  pair< int, int > coord = mode_coord(theCell, mode);
+  int x = coord.first;
+  int y = coord.second;
   int temp_x = 0;
   int temp_y = 0;
 
@@ -468,25 +459,10 @@ bool circuit::check_overlap(rect cell, rect box) {
   return true;
 }
 
-bool circuit::check_overlap(cell* theCell, rect* theRect, string mode) {
-  int x = INT_MAX;
-  int y = INT_MAX;
-  if(mode == "init_coord") {
-    x = theCell->init_x_coord;
-    y = theCell->init_y_coord;
-  }
-  else if(mode == "coord") {
-    x = theCell->x_coord;
-    y = theCell->y_coord;
-  }
-  else if(mode == "pos") {
-    x = theCell->x_pos * wsite;
-    y = theCell->y_pos * rowHeight;
-  }
-  else {
-    cerr << "circuit::check_overlap == invalid mode!" << endl;
-    exit(2);
-  }
+bool circuit::check_overlap(cell* theCell, rect* theRect, coord_mode mode) {
+  pair< int, int > coord = mode_coord(theCell, mode);
+  int x = coord.first;
+  int y = coord.second;
 
   if(theRect->xUR <= x || theRect->xLL >= x + theCell->width) return false;
   if(theRect->yUR <= y || theRect->yLL >= y + theCell->height) return false;
@@ -500,25 +476,10 @@ bool circuit::check_inside(rect cell, rect box) {
   return true;
 }
 
-bool circuit::check_inside(cell* theCell, rect* theRect, string mode) {
-  int x = INT_MAX;
-  int y = INT_MAX;
-  if(mode == "init_coord") {
-    x = theCell->init_x_coord;
-    y = theCell->init_y_coord;
-  }
-  else if(mode == "coord") {
-    x = theCell->x_coord;
-    y = theCell->y_coord;
-  }
-  else if(mode == "pos") {
-    x = theCell->x_pos * wsite;
-    y = theCell->y_pos * rowHeight;
-  }
-  else {
-    cerr << "circuit::check_inside == invalid mode!" << endl;
-    exit(2);
-  }
+bool circuit::check_inside(cell* theCell, rect* theRect, coord_mode mode) {
+  pair< int, int > coord = mode_coord(theCell, mode);
+  int x = coord.first;
+  int y = coord.second;
 
   if(theRect->xUR < x + theCell->width || theRect->xLL > x) return false;
   if(theRect->yUR < y + theCell->height || theRect->yLL > y) return false;
@@ -540,107 +501,106 @@ pair< bool, pair< int, int > > circuit::bin_search(int x_pos, cell* theCell,
   int x_step = (int)ceil(theCell->width / wsite) + edge_left + edge_right;
   int y_step = (int)ceil(theCell->height / rowHeight);
 
-  // IF y is out of border
-  if(y + y_step > (die.yUR / rowHeight)) return make_pair(false, pos);
-
-  // If even number multi-deck cell -> check top power
-  if(y_step % 2 == 0) {
-    if(rows[y].top_power == theMacro->top_power) return make_pair(false, pos);
-  }
+  // die top and top power of multi-deck cells
+  const start_row_mask* theRows = cell_start_rows(theCell);
+  if(y < 0 || y >= theRows->legal.size() || theRows->legal[y] == 0)
+    return make_pair(false, pos);
 
 #ifdef DEBUG
   cout << " - - - - - - - - - - - - - - - - - " << endl;
   cout << " Start Bin Search " << endl;
-  cout << " cell name : " << theCell->name << endl;
+  cout << " cell name : " << cell_name(theCell) << endl;
   cout << " target x : " << x << endl;
   cout << " target y : " << y << endl;
 #endif
 
-  if(x_pos > x) {
-    for(int i = 9; i > -1; i--) {
-      // check all grids are empty
-      bool available = true;
+  // candidates are x .. x + 9, searched from the side of x_pos. The free site
+  // map of the cell's class already excludes occupied, invalid and other
+  // class ( group ) sites.
+  free_site_map* theMap = cell_free_sites(theCell);
+  int x_last = min(x + 9, (int)(die.xUR / wsite) - x_step);
+  int found_x = -1;
+  if(x_pos > x)
+    found_x = theMap->find_last(x, x_last, y, x_step, y_step);
+  else
+    found_x = theMap->find_first(x, x_last, y, x_step, y_step);
 
-      if(x + i + x_step > (int)(die.xUR / wsite)) {
-        available = false;
-      }
-      else {
-        for(int k = y; k < y + y_step; k++) {
-          for(int l = x + i; l < x + i + x_step; l++) {
-            if(grid[k][l].linked_cell != NULL || grid[k][l].isValid == false) {
-              available = false;
-              break;
-            }
-            // check group regions
-            if(theCell->inGroup == true) {
-              if(grid[k][l].group != group2id[theCell->group])
-                available = false;
-            }
-            else {
-              if(grid[k][l].group != UINT_MAX) available = false;
-            }
-          }
-          if(available == false) break;
-        }
-      }
-      if(available == true) {
-        if(edge_left == 0)
-          pos = make_pair(y, x + i);
-        else
-          pos = make_pair(y, x + i + edge_left);
+  if(found_x < 0) return make_pair(false, pos);
 
-        return make_pair(available, pos);
-      }
-    }
-  }
-  else {
-    for(int i = 0; i < 10; i++) {
-      // check all grids are empty
-      bool available = true;
-      if(x + i + x_step > (int)(die.xUR / wsite)) {
-        available = false;
-      }
-      else {
-        for(int k = y; k < y + y_step; k++) {
-          for(int l = x + i; l < x + i + x_step; l++) {
-            if(grid[k][l].linked_cell != NULL || grid[k][l].isValid == false) {
-              available = false;
-              break;
-            }
-            // check group regions
-            if(theCell->inGroup == true) {
-              if(grid[k][l].group != group2id[theCell->group])
-                available = false;
-            }
-            else {
-              if(grid[k][l].group != UINT_MAX) available = false;
-            }
-          }
-          if(available == false) break;
-        }
-      }
-      if(available == true) {
 #ifdef DEBUG
-        cout << " found pos x - y : " << x << " - " << y << " Finish Search "
-             << endl;
-        cout << " - - - - - - - - - - - - - - - - - - - - - - - - " << endl;
+  cout << " found pos x - y : " << found_x << " - " << y << " Finish Search "
+       << endl;
+  cout << " - - - - - - - - - - - - - - - - - - - - - - - - " << endl;
 #endif
-        if(edge_left == 0)
-          pos = make_pair(y, x + i);
-        else
-          pos = make_pair(y, x + i + edge_left);
+  if(edge_left == 0)
+    pos = make_pair(y, found_x);
+  else
+    pos = make_pair(y, found_x + edge_left);
 
-        return make_pair(available, pos);
-      }
+  return make_pair(true, pos);
+}
+
+pair< bool, pair< int, int > > circuit::diamond_search(cell* theCell,
+                                                       int x_coord,
+                                                       int y_coord) {
+  pair< int, pair< int, int > > found =
+      nearest_position(theCell, x_coord, y_coord);
+  if(found.first == INT_MAX) return make_pair(false, make_pair(-1, -1));
+  return make_pair(true, found.second);
+}
+
+// the legal position ( y, x ) with the smallest displacement from
+// ( x_coord, y_coord ), as ( displacement, position ). of positions at equal
+// displacement the first one found is kept. the displacement is INT_MAX
+// when there is none.
+// [site_begin, site_end) limits the sites the footprint may cover, and
+// positions further than max_dist are not searched for.
+pair< int, pair< int, int > > circuit::nearest_position(cell* theCell,
+                                                        int x_coord,
+                                                        int y_coord,
+                                                        int site_begin,
+                                                        int site_end,
+                                                        int max_dist) {
+  // the full window is displacement rows by 5 * displacement sites. The
+  // first window is sized by the density of the cell's bin. It grows while
+  // the position found could still be beaten from outside of it, then far
+  // enough to cover its displacement, and that displacement bounds the next
+  // search. Nothing found in the full window leaves the cell to shift_move
+  const int min_reach = 8;
+  int y_limit = (int)displacement;
+  double util = (theCell->dense_factor < 0.95)
+                    ? max(theCell->dense_factor, 0.0)
+                    : 0.95;
+  int y_reach = min(y_limit, (int)ceil(min_reach / (1.0 - util)));
+
+  pair< int, pair< int, int > > found;
+  int bound = (max_dist < INT_MAX) ? max_dist + 1 : INT_MAX;
+  while(true) {
+    found = window_position(theCell, x_coord, y_coord, y_reach * 5, y_reach,
+                            bound, site_begin, site_end);
+    // anything outside the window is at least this far
+    int outside = min((y_reach * 5 - 3) * wsite,
+                      (int)((y_reach - 1) * rowHeight));
+    if(y_reach >= y_limit) break;
+    if(found.first < outside) break;
+    if(outside >= bound) break;
+    int next = y_reach * 2;
+    if(found.first < INT_MAX) bound = found.first + 1;
+    if(bound < INT_MAX) {
+      next = max(next, (int)(bound / rowHeight) + 2);
+      next = max(next, (bound / wsite + 3) / 5 + 1);
     }
+    y_reach = min(y_limit, next);
   }
-  return make_pair(false, pos);
+  return found;
 }
 
-pair< bool, pixel* > circuit::diamond_search(cell* theCell, int x_coord,
-                                             int y_coord) {
-  pixel* myPixel = NULL;
-  pair< bool, pair< int, int > > found;
+// nearest_position inside x_reach sites / y_reach rows around the target,
+// only positions closer than bound
+pair< int, pair< int, int > > circuit::window_position(
+    cell* theCell, int x_coord, int y_coord, int x_reach, int y_reach,
+    int bound, int site_begin, int site_end) {
+  pair< int, pair< int, int > > found = make_pair(INT_MAX, make_pair(-1, -1));
   int x_pos = (int)floor(x_coord / wsite + 0.5);
   int y_pos = (int)floor(y_coord / rowHeight + 0.5);
 
@@ -651,31 +611,31 @@ pair< bool, pixel* > circuit::diamond_search(cell* theCell, int x_coord,
 
   // set search boundary max / min
   if(theCell->inGroup == true) {
-    group* theGroup = &groups[group2id[theCell->group]];
-    x_start = max(x_pos - (int)(displacement * 5),
+    group* theGroup = &groups[theCell->group];
+    x_start = max(x_pos - x_reach,
                   (int)floor(theGroup->boundary.xLL / wsite));
-    x_end = min(x_pos + (int)(displacement * 5),
+    x_end = min(x_pos + x_reach,
                 (int)floor(theGroup->boundary.xUR / wsite) -
                     (int)floor(theCell->width / rowHeight + 0.5));
-    y_start = max(y_pos - (int)displacement,
+    y_start = max(y_pos - y_reach,
                   (int)ceil(theGroup->boundary.yLL / rowHeight));
-    y_end = min(y_pos + (int)displacement,
+    y_end = min(y_pos + y_reach,
                 (int)ceil(theGroup->boundary.yUR / rowHeight) -
                     (int)floor(theCell->height / rowHeight + 0.5));
   }
   else {
-    x_start = max(x_pos - (int)(displacement * 5), 0);
+    x_start = max(x_pos - x_reach, 0);
     x_end =
-        min(x_pos + (int)(displacement * 5),
+        min(x_pos + x_reach,
             (int)floor(rx / wsite) - (int)floor(theCell->width / wsite + 0.5));
-    y_start = max(y_pos - (int)displacement, 0);
-    y_end = min(y_pos + (int)displacement,
+    y_start = max(y_pos - y_reach, 0);
+    y_end = min(y_pos + y_reach,
                 (int)floor(ty / rowHeight) -
                     (int)floor(theCell->height / rowHeight + 0.5));
   }
 #ifdef DEBUG
   cout << " == Start Diamond Search ==  " << endl;
-  cout << " cell_name : " << theCell->name << endl;
+  cout << " cell_name : " << cell_name(theCell) << endl;
   cout << " cell width : " << theCell->width << endl;
   cout << " cell height : " << theCell->height << endl;
   cout << " cell x step : " << (int)floor(theCell->width / wsite + 0.5) << endl;
@@ -688,98 +648,120 @@ pair< bool, pixel* > circuit::diamond_search(cell* theCell, int x_coord,
   cout << " x bound ( " << x_start << ") - (" << x_end << ")" << endl;
   cout << " y bound ( " << y_start << ") - (" << y_end << ")" << endl;
 #endif
-  found = bin_search(x_pos, theCell, min(x_end, max(x_start, x_pos)),
-                     max(y_start, min(y_end, y_pos)));
-  if(found.first == true) {
-    myPixel = &grid[found.second.first][found.second.second];
-    return make_pair(found.first, myPixel);
-  }
-
-  int div = 4;
-  if(design_util > 0.6 || num_fixed_nodes > 0) div = 1;
-
-  for(int i = 1; i < (int)(displacement * 2) / div; i++) {
-    vector< pixel* > avail_list;
-    avail_list.reserve(i * 4);
-    pixel* myPixel = NULL;
 
-    int x_offset = 0;
-    int y_offset = 0;
+  macro* theMacro = &macros[theCell->type];
+  int edge_left = (theMacro->edgetypeLeft == 1) ? 2 : 0;
+  int edge_right = (theMacro->edgetypeRight == 1) ? 2 : 0;
+  int x_step = (int)ceil(theCell->width / wsite) + edge_left + edge_right;
+  int y_step = (int)ceil(theCell->height / rowHeight);
 
-    // right side
-    for(int j = 1; j < i * 2; j++) {
-      x_offset = -((j + 1) / 2);
-      if(j % 2 == 1)
-        y_offset = (i * 2 - j) / 2;
-      else
-        y_offset = -(i * 2 - j) / 2;
-      found = bin_search(x_pos, theCell,
-                         min(x_end, max(x_start, (x_pos + x_offset * 10))),
-                         min(y_end, max(y_start, (y_pos + y_offset))));
-      if(found.first == true) {
-        myPixel = &grid[found.second.first][found.second.second];
-        avail_list.push_back(myPixel);
-      }
+  // footprint ( cell + edge spacing ) window; bin_search probes used to
+  // reach 9 sites right of x_end
+  free_site_map* theMap = cell_free_sites(theCell);
+  int x_first = max(x_start, site_begin);
+  int x_last = min(x_end + 9, (int)(die.xUR / wsite) - x_step);
+  if(site_end != INT_MAX) x_last = min(x_last, site_end - x_step);
+  // footprint position that puts the cell on x_coord
+  int x_target = (int)floor(x_coord / (double)wsite) - edge_left;
+
+  // rows are visited in increasing distance from y_coord. In each row the
+  // free segment index gives the nearest fitting positions on both sides of
+  // x_target, and the search stops when no row left can beat the best one.
+  // best_dist is the displacement a new position has to beat
+  int best_dist = bound;
+  // footprint starts of row y that can still beat best_dist
+  auto row_window = [&](int y, int& lo, int& hi) {
+    lo = x_first;
+    hi = x_last;
+    if(best_dist == INT_MAX) return;
+    int reach = best_dist - abs(y_coord - y * (int)rowHeight);
+    lo = max(lo, (int)floor((x_coord - reach) / (double)wsite) - edge_left);
+    hi = min(hi, (int)ceil((x_coord + reach) / (double)wsite) - edge_left);
+  };
+  // nearest legal start row from y towards y_limit whose window may hold
+  // x_step free sites by the capacity pyramid. rows further out have
+  // narrower windows, so the window of y covers them
+  const start_row_mask* theRows = cell_start_rows(theCell);
+  auto next_row = [&](int y, int y_limit) {
+    int dir = (y_limit >= y) ? 1 : -1;
+    while(y >= 0 && y < theRows->legal.size()) {
+      y = (dir == 1) ? theRows->next_legal[y] : theRows->prev_legal[y];
+      if(y < 0 || (y - y_limit) * dir > 0) return -1;
+      int lo, hi;
+      row_window(y, lo, hi);
+      if(lo > hi) return -1;
+      int room = theMap->next_room_row(lo, hi + x_step - 1, y, y_limit, x_step);
+      if(room == y || room < 0) return room;
+      y = room;
     }
-
-    // left side
-    for(int j = 1; j < (i + 1) * 2; j++) {
-      x_offset = (j - 1) / 2;
-      if(j % 2 == 1)
-        y_offset = ((i + 1) * 2 - j) / 2;
+    return -1;
+  };
+  // keeps the nearest, the first found of equal ones
+  auto add_position = [&](int y, int x, int y_dist) {
+    int dist = abs(x_coord - x * wsite) + y_dist;
+    if(dist >= best_dist) return;
+    found = make_pair(dist, make_pair(y, x));
+    best_dist = dist;
+  };
+
+  int y_mid = max(y_start, min(y_end, y_pos));
+  int down = next_row(y_mid, y_start);
+  int up = (y_mid < y_end) ? next_row(y_mid + 1, y_end) : -1;
+  while(down >= 0 || up >= 0) {
+    // same row order as the ring walk, y_mid - d before y_mid + d
+    int y = -1;
+    if(down >= 0 && (up < 0 || y_mid - down <= up - y_mid)) {
+      y = down;
+      down = (y > y_start) ? next_row(y - 1, y_start) : -1;
+    }
+    else {
+      y = up;
+      up = (y < y_end) ? next_row(y + 1, y_end) : -1;
+    }
+    int y_dist = abs(y_coord - y * (int)rowHeight);
+    if(y_dist >= best_dist) {
+      // rows further out on this side can not be closer either
+      if(y <= y_mid)
+        down = -1;
       else
-        y_offset = -((i + 1) * 2 - j) / 2;
-      found = bin_search(x_pos, theCell,
-                         min(x_end, max(x_start, (x_pos + x_offset * 10))),
-                         min(y_end, max(y_start, (y_pos + y_offset))));
-      if(found.first == true) {
-        myPixel = &grid[found.second.first][found.second.second];
-        avail_list.push_back(myPixel);
-      }
+        up = -1;
+      continue;
     }
 
-    // check from vector
-    unsigned dist = UINT_MAX;
-    int best = INT_MAX;
-    for(int j = 0; j < avail_list.size(); j++) {
-      int temp_dist = abs(x_coord - avail_list[j]->x_pos * wsite) +
-                      abs(y_coord - avail_list[j]->y_pos * rowHeight);
-      if(temp_dist < dist) {
-        dist = temp_dist;
-        best = j;
-      }
-    }
-    if(best != INT_MAX) {
-      return make_pair(true, avail_list[best]);
+    int lo, hi;
+    row_window(y, lo, hi);
+    if(lo > hi) continue;
+    bool room = true;
+    for(int j = 0; j < y_step && room; j++)
+      room = theMap->has_room(lo, hi + x_step - 1, y + j, x_step);
+    if(room == false) continue;
+
+    // the nearest position left of x_target ( inclusive ) first, then the
+    // nearest right of it in what is left of the window
+    int right_lo = max(x_target + 1, lo);
+    int c = theMap->find_last(lo, min(x_target, hi), y, x_step, y_step);
+    if(c >= 0) {
+      add_position(y, c + edge_left, y_dist);
+      row_window(y, lo, hi);
     }
+    c = theMap->find_first(right_lo, hi, y, x_step, y_step);
+    if(c >= 0) add_position(y, c + edge_left, y_dist);
   }
-  return make_pair(false, myPixel);
+
+#ifdef DEBUG
+  if(found.first < INT_MAX)
+    cout << " found pos x - y : " << found.second.second << " - "
+         << found.second.first << endl;
+#endif
+  return found;
 }
 
-bool circuit::direct_move(cell* theCell, string mode) {
-  int x = INT_MAX;
-  int y = INT_MAX;
-  if(mode == "init_coord") {
-    x = theCell->init_x_coord;
-    y = theCell->init_y_coord;
-  }
-  else if(mode == "coord") {
-    x = theCell->x_coord;
-    y = theCell->y_coord;
-  }
-  else if(mode == "pos") {
-    x = theCell->x_pos * wsite;
-    y = theCell->y_pos * rowHeight;
-  }
-  else {
-    cerr << "circuit::check_inside == invalid mode!" << endl;
-    exit(2);
-  }
-  return direct_move(theCell, x, y);
+bool circuit::direct_move(cell* theCell, coord_mode mode) {
+  pair< int, int > coord = mode_coord(theCell, mode);
+  return direct_move(theCell, coord.first, coord.second);
 }
 
 bool circuit::direct_move(cell* theCell, int x_coord, int y_coord) {
-  pixel* myPixel = NULL;
   pair< bool, pair< int, int > > found;
   int x_pos = (int)floor(x_coord / wsite + 0.5);
   int y_pos = (int)floor(y_coord / rowHeight + 0.5);
@@ -797,7 +779,8 @@ bool circuit::direct_move(cell* theCell, int x_coord, int y_coord) {
   else {
     for(int i = y_pos; i < y_end; i++) {
       for(int j = x_pos; j < x_end; j++) {
-        if(grid[i][j].linked_cell != NULL || grid[i][j].isValid == true)
+        const pixel* thePixel = get_pixel(j, i);
+        if(thePixel->isEmpty() == false || thePixel->isValid() == true)
           return false;
       }
     }
@@ -806,6 +789,10 @@ bool circuit::direct_move(cell* theCell, int x_coord, int y_coord) {
   }
 }
 
+// the region cells are journaled: when theCell can't be inserted they are
+// rolled back where they were. only the cells of theCell's group ( or the
+// non group cells ) are moved, other groups may be placed by other threads.
+// returns true if theCell and every erased cell were placed
 bool circuit::shift_move(cell* theCell, int x, int y) {
   //	cout << " shift_move start " << endl;
 
@@ -816,105 +803,73 @@ bool circuit::shift_move(cell* theCell, int x, int y) {
   theRect.yLL = max(die.yLL, y - theCell->height * 3);
   theRect.yUR = min(die.yUR, y + theCell->height * 3);
 
-  vector< cell* > overlap_region_cells = get_cells_from_boundary(&theRect);
+  // region cells of theCell's class, in a fixed order
+  vector< cell* > overlap_region_cells;
+  vector< cell* > region_cells = get_cells_from_boundary(&theRect);
+  for(int i = 0; i < region_cells.size(); i++)
+    if(region_cells[i]->group == theCell->group)
+      overlap_region_cells.push_back(region_cells[i]);
+  move_journal journal;
 
   // erase region cells
   for(int i = 0; i < overlap_region_cells.size(); i++) {
     cell* around_cell = overlap_region_cells[i];
-    if(theCell->inGroup == around_cell->inGroup) {
-      // assert ( check_inside(around_cell,&theRect,"coord") == true );
-      erase_pixel(around_cell);
-    }
+    // assert ( check_inside(around_cell,&theRect,"coord") == true );
+    erase_pixel(around_cell, &journal);
   }
 
   // place target cell
-  if(map_move(theCell, x, y) == false) {
+  if(map_move(theCell, x, y, &journal) == false) {
     cout << " can't insert center cell !! " << endl;
-    cout << " cell_name : " << theCell->name << endl;
+    cout << " cell_name : " << cell_name(theCell) << endl;
+    rollback(journal);
     return false;
   }
 
-  // rebuild erased cells
+  // rebuild erased cells, all of them : stopping at the first failure
+  // would leave the rest of the region unplaced
+  bool valid = true;
   for(int i = 0; i < overlap_region_cells.size(); i++) {
     cell* around_cell = overlap_region_cells[i];
-    if(theCell->inGroup == around_cell->inGroup) {
-      if(map_move(around_cell, around_cell->init_x_coord,
-                  around_cell->init_y_coord) == false) {
+    if(map_move(around_cell, around_cell->init_x_coord,
+                around_cell->init_y_coord, &journal) == false) {
 #ifdef DEBUG
-        cout << " Shift move fail !!" << endl;
-        cout << " cell name : " << around_cell->name << endl;
-        cout << " x_coord : " << around_cell->init_x_coord << endl;
-        cout << " y_coord : " << around_cell->init_y_coord << endl;
+      cout << " Shift move fail !!" << endl;
+      cout << " cell name : " << cell_name(around_cell) << endl;
+      cout << " x_coord : " << around_cell->init_x_coord << endl;
+      cout << " y_coord : " << around_cell->init_y_coord << endl;
 #endif
-        return false;
-      }
+      valid = false;
     }
   }
-  return true;
+  journal.commit();
+  return valid;
 }
 
-bool circuit::shift_move(cell* theCell, string mode) {
-  int x = INT_MAX;
-  int y = INT_MAX;
-  if(mode == "init_coord") {
-    x = theCell->init_x_coord;
-    y = theCell->init_y_coord;
-  }
-  else if(mode == "coord") {
-    x = theCell->x_coord;
-    y = theCell->y_coord;
-  }
-  else if(mode == "pos") {
-    x = theCell->x_pos * wsite;
-    y = theCell->y_pos * rowHeight;
-  }
-  else {
-    cerr << "circuit::shift_move() == invalid mode!" << endl;
-    exit(2);
-  }
-  return shift_move(theCell, x, y);
+bool circuit::shift_move(cell* theCell, coord_mode mode) {
+  pair< int, int > coord = mode_coord(theCell, mode);
+  return shift_move(theCell, coord.first, coord.second);
 }
 
-bool circuit::map_move(cell* theCell, string mode) {
-  int x = INT_MAX;
-  int y = INT_MAX;
-  if(mode == "init_coord") {
-    x = theCell->init_x_coord;
-    y = theCell->init_y_coord;
-  }
-  else if(mode == "coord") {
-    x = theCell->x_coord;
-    y = theCell->y_coord;
-  }
-  else if(mode == "pos") {
-    x = theCell->x_pos * wsite;
-    y = theCell->y_pos * rowHeight;
-  }
-  else {
-    cerr << "circuit::check_inside == invalid mode!" << endl;
-    exit(2);
-  }
-  return map_move(theCell, x, y);
+bool circuit::map_move(cell* theCell, coord_mode mode,
+                       move_journal* journal) {
+  pair< int, int > coord = mode_coord(theCell, mode);
+  return map_move(theCell, coord.first, coord.second, journal);
 }
 
-bool circuit::map_move(cell* theCell, int x, int y) {
-  pair< bool, pixel* > myPixel = diamond_search(theCell, x, y);
+// diamond_search returns the least displacement position, so there is no
+// nearer position to snap to from there
+bool circuit::map_move(cell* theCell, int x, int y, move_journal* journal) {
+  pair< bool, pair< int, int > > myPixel = diamond_search(theCell, x, y);
   if(myPixel.first == true) {
-    pair< bool, pixel* > nearPixel =
-        diamond_search(theCell, myPixel.second->x_pos * wsite,
-                       myPixel.second->y_pos * rowHeight);
-    if(nearPixel.first == true) {
-      paint_pixel(theCell, nearPixel.second->x_pos, nearPixel.second->y_pos);
-      // cout << " near found!! " << endl;
-    }
-    else
-      paint_pixel(theCell, myPixel.second->x_pos, myPixel.second->y_pos);
+    paint_pixel(theCell, myPixel.second.second, myPixel.second.first,
+                journal);
     return true;
   }
   else {
 #ifdef DEBUG
     cout << " Map move fail !!" << endl;
-    cout << " cell name : " << theCell->name << endl;
+    cout << " cell name : " << cell_name(theCell) << endl;
     cout << " init_x_coord : " << theCell->init_x_coord << endl;
     cout << " init_y_coord : " << theCell->init_y_coord << endl;
 #endif
@@ -934,8 +889,9 @@ vector< cell* > circuit::overlap_cells(cell* theCell) {
 
   for(int i = theCell->y_pos; i < theCell->y_pos + step_y; i++) {
     for(int j = theCell->x_pos; j < theCell->y_pos + step_x; j++) {
-      if(grid[i][j].linked_cell != NULL) {
-        cell_list[grid[i][j].linked_cell->id] = grid[i][j].linked_cell;
+      cell* gridCell = pixel_cell(get_pixel(j, i));
+      if(gridCell != NULL) {
+        cell_list[gridCell->id] = gridCell;
       }
     }
   }
@@ -961,24 +917,29 @@ vector< cell* > circuit::get_cells_from_boundary(rect* theRect) {
 
   vector< cell* > list;
 
-  OPENDP_HASH_MAP< unsigned, cell* > cell_list;
-#ifdef USE_GOOGLE_HASH
-  cell_list.set_empty_key(UINT_MAX);
-#endif
-
+  // painted cells in ( row, x_pos ) order, a multi-row cell in the lowest
+  // of its rows inside the boundary. the groups placed in parallel paint
+  // into the same rows, so the row lists are read under their lock; cells
+  // of other groups may come and go, but the order of the others does not
+  // depend on them
   for(int i = y_start; i < y_end; i++) {
-    for(int j = x_start; j < x_end; j++) {
-      if(grid[i][j].linked_cell != NULL) {
-        if(grid[i][j].linked_cell->isFixed == false)
-          cell_list[grid[i][j].linked_cell->id] = grid[i][j].linked_cell;
+    vector< cell* >& row_cells = rows[i].cell_list;
+#pragma omp critical(row_cell_list)
+    {
+      vector< cell* >::iterator it = std::partition_point(
+          row_cells.begin(), row_cells.end(), [&](cell* rowCell) {
+            return rowCell->x_pos + (int)ceil(rowCell->width / wsite) <=
+                   x_start;
+          });
+      for(; it != row_cells.end() && (*it)->x_pos < x_end; it++) {
+        cell* rowCell = *it;
+        if(rowCell->isFixed) continue;
+        // already taken from a lower row
+        if(i != max(rowCell->y_pos, y_start)) continue;
+        list.push_back(rowCell);
       }
     }
   }
-
-  list.reserve(cell_list.size());
-  for(auto& currCell : cell_list) {
-    list.push_back(currCell.second);
-  }
   return list;
 }
 
@@ -1018,45 +979,30 @@ bool circuit::swap_cell(cell* cellA, cell* cellB) {
   return false;
 }
 
-bool circuit::refine_move(cell* theCell, string mode) {
-  int x = INT_MAX;
-  int y = INT_MAX;
-  if(mode == "init_coord") {
-    x = theCell->init_x_coord;
-    y = theCell->init_y_coord;
-  }
-  else if(mode == "coord") {
-    x = theCell->x_coord;
-    y = theCell->y_coord;
-  }
-  else if(mode == "pos") {
-    x = theCell->x_pos * wsite;
-    y = theCell->y_pos * rowHeight;
-  }
-  else {
-    cerr << "circuit::refine_move == invalid mode!" << endl;
-    exit(2);
-  }
-  return refine_move(theCell, x, y);
+bool circuit::refine_move(cell* theCell, coord_mode mode) {
+  pair< int, int > coord = mode_coord(theCell, mode);
+  return refine_move(theCell, coord.first, coord.second);
 }
 //
 bool circuit::refine_move(cell* theCell, int x_coord, int y_coord) {
-  pair< bool, pixel* > myPixel = diamond_search(theCell, x_coord, y_coord);
+  pair< bool, pair< int, int > > myPixel =
+      diamond_search(theCell, x_coord, y_coord);
   if(myPixel.first == true) {
     double new_dist =
-        abs(theCell->init_x_coord - myPixel.second->x_pos * wsite) +
-        abs(theCell->init_y_coord - myPixel.second->y_pos * rowHeight);
+        abs(theCell->init_x_coord - myPixel.second.second * wsite) +
+        abs(theCell->init_y_coord - myPixel.second.first * rowHeight);
     if(new_dist / rowHeight > max_disp_const) return false;
 
-    double benefit = dist_benefit(theCell, myPixel.second->x_pos * wsite,
-                                  myPixel.second->y_pos * rowHeight);
+    double benefit = dist_benefit(theCell, myPixel.second.second * wsite,
+                                  myPixel.second.first * rowHeight);
     // if( benefit < 2001-sum_displacement/20 ) {
     if(benefit < 0) {
       // cout << " refine benefit : " << benefit << " : " << 2001 -
       // sum_displacement/10 << endl;
+#pragma omp atomic
       sum_displacement++;
       erase_pixel(theCell);
-      paint_pixel(theCell, myPixel.second->x_pos, myPixel.second->y_pos);
+      paint_pixel(theCell, myPixel.second.second, myPixel.second.first);
       // save_score();
       return true;
     }
@@ -1067,7 +1013,6 @@ bool circuit::refine_move(cell* theCell, int x_coord, int y_coord) {
     return false;
 }
 
-pixel* circuit::get_pixel(int x_pos, int y_pos) {}
 
 pair< bool, cell* > circuit::nearest_cell(int x_coord, int y_coord) {
   bool found = false;